@@ -0,0 +1,140 @@
+/*
+ * Benchmark of the data path of ReliableUdpServer and ReliableUdpClient.
+ *
+ * A server streams to --clients clients on one node over a point-to-point
+ * link dropping --errorRate of the packets to the clients. It reports the
+ * heap allocations made while the simulation runs per packet the server
+ * sends, original or retransmitted, and the packets sent per wall-clock
+ * second. Allocations of the ns-3 stack below the sockets are included.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "../reliable-udp-server-helper.h"
+#include "../reliable-udp-client-helper.h"
+
+using namespace ns3;
+
+namespace {
+
+bool g_counting = false;
+uint64_t g_allocations = 0;
+uint64_t g_packetsSent = 0;
+uint64_t g_packetsRetransmitted = 0;
+uint64_t g_packetsReceived = 0;
+uint64_t g_acksSent = 0;
+
+void
+Count (uint64_t *counter, uint32_t oldValue, uint32_t newValue)
+{
+  *counter += newValue - oldValue;
+}
+
+void *
+Allocate (std::size_t size)
+{
+  if (g_counting) {
+    g_allocations++;
+  }
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == 0) {
+    throw std::bad_alloc ();
+  }
+  return p;
+}
+
+} // namespace
+
+void *operator new (std::size_t size) { return Allocate (size); }
+void *operator new[] (std::size_t size) { return Allocate (size); }
+void operator delete (void *p) noexcept { std::free (p); }
+void operator delete[] (void *p) noexcept { std::free (p); }
+void operator delete (void *p, std::size_t) noexcept { std::free (p); }
+void operator delete[] (void *p, std::size_t) noexcept { std::free (p); }
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t clients = 1;
+  std::string bitrate = "20Mbps";
+  std::string dataRate = "1Gbps";
+  double errorRate = 0.01;
+  std::string fecMode = "None";
+  std::string reliabilityMode = "Ack";
+  double duration = 10;
+  CommandLine cmd;
+  cmd.AddValue ("clients", "Number of clients", clients);
+  cmd.AddValue ("bitrate", "Video bitrate of each client", bitrate);
+  cmd.AddValue ("dataRate", "Rate of the link", dataRate);
+  cmd.AddValue ("errorRate", "Packet error rate towards the clients", errorRate);
+  cmd.AddValue ("fecMode", "FecMode of the server: None, Xor or ReedSolomon", fecMode);
+  cmd.AddValue ("reliabilityMode", "ReliabilityMode of the server and clients: Ack or Nack", reliabilityMode);
+  cmd.AddValue ("duration", "Simulated seconds of streaming", duration);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::ReliableUdpGopFrameSource::Bitrate", DataRateValue (DataRate (bitrate)));
+  NodeContainer nodes;
+  nodes.Create (2);
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue (dataRate));
+  p2p.SetChannelAttribute ("Delay", StringValue ("5ms"));
+  NetDeviceContainer devices = p2p.Install (nodes);
+  Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+  em->SetAttribute ("ErrorRate", DoubleValue (errorRate));
+  em->SetAttribute ("ErrorUnit", StringValue ("ERROR_UNIT_PACKET"));
+  devices.Get (0)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+  InternetStackHelper stack;
+  stack.Install (nodes);
+  Ipv4AddressHelper addr;
+  addr.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = addr.Assign (devices);
+
+  ReliableUdpServerHelper server (9);
+  server.SetAttribute ("FecMode", StringValue (fecMode));
+  server.SetAttribute ("ReliabilityMode", StringValue (reliabilityMode));
+  ApplicationContainer serverApps = server.Install (nodes.Get (1));
+  ReliableUdpClientHelper client (interfaces.GetAddress (1), 9);
+  client.SetAttribute ("ReliabilityMode", StringValue (reliabilityMode));
+  ApplicationContainer clientApps;
+  for (uint32_t i = 0; i < clients; i++) {
+    clientApps.Add (client.Install (nodes.Get (0)));
+  }
+  serverApps.Start (Seconds (0));
+  clientApps.Start (Seconds (0));
+  clientApps.Stop (Seconds (duration));
+  serverApps.Stop (Seconds (duration));
+
+  serverApps.Get (0)->TraceConnectWithoutContext ("PacketsSent", MakeBoundCallback (&Count, &g_packetsSent));
+  serverApps.Get (0)->TraceConnectWithoutContext ("PacketsRetransmitted",
+                                                  MakeBoundCallback (&Count, &g_packetsRetransmitted));
+  for (uint32_t i = 0; i < clients; i++) {
+    clientApps.Get (i)->TraceConnectWithoutContext ("PacketsReceived",
+                                                    MakeBoundCallback (&Count, &g_packetsReceived));
+    clientApps.Get (i)->TraceConnectWithoutContext ("AcksSent", MakeBoundCallback (&Count, &g_acksSent));
+  }
+
+  Simulator::Stop (Seconds (duration + 1));
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  g_counting = true;
+  Simulator::Run ();
+  g_counting = false;
+  double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  Simulator::Destroy ();
+
+  uint64_t sent = g_packetsSent + g_packetsRetransmitted;
+  std::cout << "packets sent        " << g_packetsSent << " + " << g_packetsRetransmitted << " retransmitted" << std::endl
+            << "packets received    " << g_packetsReceived << std::endl
+            << "acks sent           " << g_acksSent << std::endl
+            << "allocations         " << g_allocations << std::endl
+            << "allocations/packet  " << std::fixed << std::setprecision (2)
+            << (sent > 0 ? double (g_allocations) / sent : 0) << std::endl
+            << "wall clock s        " << std::setprecision (3) << seconds << std::endl
+            << "packets/s           " << std::setprecision (0) << sent / seconds << std::endl;
+  return 0;
+}
@@ -0,0 +1,2 @@
+// Builds the source under test into the benchmark program
+#include "../reliable-udp-client-helper.cc"
@@ -0,0 +1,2 @@
+// Builds the header under test into the benchmark program
+#include "../reliable-udp-header.cc"
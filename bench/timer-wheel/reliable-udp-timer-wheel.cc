@@ -0,0 +1,2 @@
+// Builds the timer wheel under test into the benchmark program
+#include "../reliable-udp-timer-wheel.cc"
@@ -0,0 +1,136 @@
+/*
+ * Benchmark of per-packet retransmission timers.
+ *
+ * It keeps --timers timers outstanding, as a server with that many packets
+ * in flight would: every --rtt / --timers a packet is acked, cancelling its
+ * timer, and a new one is sent, starting a timer of --rto. Timers run either
+ * as one simulator event each, scheduled and cancelled per packet, or in a
+ * ReliableUdpTimerWheel. For each it reports the wall-clock time, the
+ * simulator events executed and the time per timer.
+ */
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "ns3/core-module.h"
+#include "../reliable-udp-timer-wheel.h"
+
+using namespace ns3;
+
+namespace {
+
+/// Per-packet timer of both kinds
+struct Slot
+{
+  EventId event;          //!< Timer as a simulator event
+  ReliableUdpTimer timer; //!< Timer in the wheel
+};
+
+std::vector<Slot> g_slots;
+uint32_t g_next;
+uint64_t g_expired;
+Time g_interval;
+Time g_rto;
+Ptr<ReliableUdpTimerWheel> g_wheel;
+
+void
+Expire (void *context, uint64_t argument)
+{
+  g_expired++;
+}
+
+void
+ExpireEvent (void)
+{
+  g_expired++;
+}
+
+void
+StepEvents (void)
+{
+  Slot &slot = g_slots[g_next];
+  g_next = (g_next + 1) % g_slots.size ();
+  Simulator::Cancel (slot.event);
+  slot.event = Simulator::Schedule (g_rto, &ExpireEvent);
+  Simulator::Schedule (g_interval, &StepEvents);
+}
+
+void
+StepWheel (void)
+{
+  Slot &slot = g_slots[g_next];
+  g_next = (g_next + 1) % g_slots.size ();
+  slot.timer.Cancel ();
+  g_wheel->Schedule (slot.timer, Simulator::Now () + g_rto);
+  Simulator::Schedule (g_interval, &StepWheel);
+}
+
+void
+Run (bool wheel, uint32_t timers, Time duration, Time granularity)
+{
+  g_slots.assign (timers, Slot ());
+  g_next = 0;
+  g_expired = 0;
+  if (wheel) {
+    g_wheel = Create<ReliableUdpTimerWheel> (granularity);
+    for (uint32_t i = 0; i < timers; i++) {
+      g_slots[i].timer.SetFunction (&Expire, 0, i);
+    }
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Schedule (Seconds (0), wheel ? &StepWheel : &StepEvents);
+  Simulator::Stop (duration);
+  Simulator::Run ();
+  double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  uint64_t events = Simulator::GetEventCount ();
+  // Outstanding timers of both kinds go before the simulator
+  g_slots.clear ();
+  g_wheel = 0;
+  Simulator::Destroy ();
+
+  uint64_t steps = duration.GetTimeStep () / g_interval.GetTimeStep ();
+  std::cout << std::left << std::setw (10) << (wheel ? "wheel" : "events")
+            << std::right << std::setw (10) << timers
+            << std::setw (12) << std::fixed << std::setprecision (3) << seconds
+            << std::setw (14) << events
+            << std::setw (12) << g_expired
+            << std::setw (14) << std::setprecision (1) << seconds * 1e9 / steps << std::endl;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t timers = 10000;
+  Time rtt = MilliSeconds (100);
+  Time rto = MilliSeconds (300);
+  Time duration = Seconds (10);
+  Time granularity = MilliSeconds (1);
+  std::string mode = "both";
+  CommandLine cmd;
+  cmd.AddValue ("timers", "Timers outstanding", timers);
+  cmd.AddValue ("rtt", "Time a timer runs before it is cancelled", rtt);
+  cmd.AddValue ("rto", "Timeout of a timer; below rtt every timer expires", rto);
+  cmd.AddValue ("duration", "Simulated time per run", duration);
+  cmd.AddValue ("granularity", "Tick of the timer wheel", granularity);
+  cmd.AddValue ("mode", "events, wheel or both", mode);
+  cmd.Parse (argc, argv);
+
+  g_interval = TimeStep (std::max<int64_t> (rtt.GetTimeStep () / timers, 1));
+  g_rto = rto;
+  std::cout << std::left << std::setw (10) << "timers"
+            << std::right << std::setw (10) << "count"
+            << std::setw (12) << "wall s"
+            << std::setw (14) << "sim events"
+            << std::setw (12) << "expired"
+            << std::setw (14) << "ns/packet" << std::endl;
+  if (mode != "wheel") {
+    Run (false, timers, duration, granularity);
+  }
+  if (mode != "events") {
+    Run (true, timers, duration, granularity);
+  }
+  return 0;
+}
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <sstream>
+#include <vector>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
@@ -6,65 +10,410 @@
 #include "ns3/applications-module.h"
 #include "ns3/csma-module.h"
 #include "ns3/bridge-module.h"
+#ifdef NS3_MPI
+#include <mpi.h>
+#include "ns3/mpi-interface.h"
+#endif
 
 
 #include "reliable-udp-client-helper.h"
 #include "reliable-udp-client.h"
 #include "reliable-udp-server-helper.h"
 #include "reliable-udp-server.h"
+#include "reliable-udp-stats-helper.h"
+#include "reliable-udp-topology-helper.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("master");
 
+// What a run measures for --result
+static std::vector<double> g_delays;     // One-way delays of data packets in ms
+static std::vector<uint64_t> g_bytesDelivered; // Payload bytes delivered in order to each client
+static uint64_t g_packetsSent = 0;       // Data packets sent for the first time
+static uint64_t g_packetsRetransmitted = 0; // Data packets sent again
+static uint64_t g_acksSent = 0;          // Acks and NACKs sent by the clients
+static std::vector<double> g_recoveries; // Times from finding a packet missing to its arrival in ms
+
+static void
+RecordDelay (Time delay)
+{
+	g_delays.push_back (delay.GetSeconds () * 1000);
+}
+
+static void
+RecordRecovery (Time latency)
+{
+	g_recoveries.push_back (latency.GetSeconds () * 1000);
+}
+
+static void
+AddBytesDelivered (uint64_t *total, uint64_t oldValue, uint64_t newValue)
+{
+	*total += newValue - oldValue;
+}
+
+static void
+CountPackets (uint64_t *total, uint32_t oldValue, uint32_t newValue)
+{
+	*total += newValue - oldValue;
+}
+
+// Jain's fairness index: 1 when all shares are equal, 1/n when one takes all
+static double
+JainIndex (const std::vector<double> &shares)
+{
+	double sum = 0;
+	double sumOfSquares = 0;
+	for (uint32_t i = 0; i < shares.size (); i++) {
+		sum += shares[i];
+		sumOfSquares += shares[i] * shares[i];
+	}
+	return sumOfSquares > 0 ? sum * sum / (shares.size () * sumOfSquares) : 1;
+}
+
+// p-th percentile of the samples by the nearest rank; 0 without samples
+static double
+Percentile (std::vector<double> &samples, double p)
+{
+	if (samples.empty ()) {
+		return 0;
+	}
+	size_t rank = std::min (samples.size () - 1, size_t (p / 100 * samples.size ()));
+	std::nth_element (samples.begin (), samples.begin () + rank, samples.end ());
+	return samples[rank];
+}
+
+#ifdef NS3_MPI
+// Collect the samples of every process into process 0
+static void
+GatherSamples (std::vector<double> &samples, uint32_t nSystems)
+{
+	int count = samples.size ();
+	std::vector<int> counts (nSystems, 0);
+	MPI_Gather (&count, 1, MPI_INT, counts.data (), 1, MPI_INT, 0, MPI_COMM_WORLD);
+	std::vector<int> offsets (nSystems, 0);
+	for (uint32_t i = 1; i < nSystems; i++) {
+		offsets[i] = offsets[i - 1] + counts[i - 1];
+	}
+	std::vector<double> all (offsets.back () + counts.back ());
+	MPI_Gatherv (samples.data (), count, MPI_DOUBLE, all.data (), counts.data (), offsets.data (),
+	             MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	samples.swap (all);
+}
+#endif
+
 int 
 main (int argc, char *argv[])
 {
-	NodeContainer nodes;
-	nodes.Create(2);
+	std::string congestionControl = "ns3::ReliableUdpAimd";
+	std::string frameTrace = "";
+	std::string videoBitrate = "1Mbps";
+	std::string fecMode = "None";
+	std::string reliabilityMode = "Ack";
+	uint32_t nClients = 1;
+	uint32_t nStreams = 1;
+	std::string bitrateLadder = "";
+	std::string abrPolicy = "ns3::ReliableUdpThroughputAbr";
+	std::string stats = "";
+	std::string eventTrace = "";
+	std::string dataRate = "5Mbps";
+	std::string delay = "2ms";
+	double errorRate = 0.001;
+	double startTime = 1.0;
+	double stopTime = 9.0;
+	bool pcap = true;
+	std::string result = "";
+	std::string topology = "p2p";
+	std::string accessRate = "100Mbps";
+	uint32_t crossFlows = 0;
+	uint32_t nRegions = 4;
+	bool distributed = false;
+
+	CommandLine cmd;
+	cmd.AddValue ("congestionControl", "Congestion controller of the server: ns3::ReliableUdpAimd, "
+	              "ns3::ReliableUdpDelayGradient or ns3::ReliableUdpBbr", congestionControl);
+	cmd.AddValue ("frameTrace", "Frame-size trace to stream; a synthetic GOP model is used if empty", frameTrace);
+	cmd.AddValue ("videoBitrate", "Average bitrate of the synthetic GOP model", videoBitrate);
+	cmd.AddValue ("fecMode", "Forward error correction of the server: None, Xor or ReedSolomon", fecMode);
+	cmd.AddValue ("reliabilityMode", "How clients report losses: Ack or Nack", reliabilityMode);
+	cmd.AddValue ("nClients", "Number of clients streaming from the server", nClients);
+	cmd.AddValue ("nStreams", "Number of streams per client; each extra one starts a second after the last", nStreams);
+	cmd.AddValue ("bitrateLadder", "Comma-separated encoding bitrates to adapt over; empty keeps videoBitrate", bitrateLadder);
+	cmd.AddValue ("abrPolicy", "Adaptive bitrate policy: ns3::ReliableUdpThroughputAbr or ns3::ReliableUdpBufferAbr", abrPolicy);
+	cmd.AddValue ("stats", "Write samples of the server and client counters to <stats>.csv and a summary to <stats>.json", stats);
+	cmd.AddValue ("eventTrace", "Record per-packet events to <eventTrace>-server.bin and <eventTrace>-client-<i>.bin; "
+	              "decode them with tools/decode-events.py", eventTrace);
+	cmd.AddValue ("topology", "p2p: all clients on one node linked to the server; dumbbell: nClients "
+	              "server/client pairs sharing a bottleneck; star: one server at the hub, a client on each spoke; "
+	              "regions: nRegions regions of a server and clients around a core, streaming across it", topology);
+	cmd.AddValue ("nRegions", "Number of regions of the regions topology", nRegions);
+	cmd.AddValue ("distributed", "Split the regions topology across the MPI processes, one region after the other, "
+	              "e.g. under mpirun -np 4; needs ns-3 configured with --enable-mpi", distributed);
+	cmd.AddValue ("dataRate", "Data rate of the p2p link, the dumbbell bottleneck, each spoke or each core link", dataRate);
+	cmd.AddValue ("delay", "Propagation delay of the p2p link, the dumbbell bottleneck, each spoke or each core link", delay);
+	cmd.AddValue ("accessRate", "Data rate of the leaf links of the dumbbell and the access links of the regions", accessRate);
+	cmd.AddValue ("crossFlows", "Number of greedy TCP flows crossing the dumbbell bottleneck", crossFlows);
+	cmd.AddValue ("errorRate", "Packet error rate received by the server in p2p, by each client otherwise", errorRate);
+	cmd.AddValue ("startTime", "Time the server starts streaming in seconds; clients start at 0", startTime);
+	cmd.AddValue ("stopTime", "Time the server stops in seconds; clients stop a second later", stopTime);
+	cmd.AddValue ("pcap", "Write pcap traces of the link", pcap);
+	cmd.AddValue ("result", "Write the parameters and the goodput, delay percentiles, retransmission "
+	              "ratio and simulator events per simulated second of the run to this JSON file; vary --RngRun to repeat a run", result);
+	cmd.Parse (argc, argv);
+	NS_ABORT_MSG_UNLESS (startTime < stopTime, "startTime must be before stopTime");
+	NS_ABORT_MSG_UNLESS (topology == "p2p" || topology == "dumbbell" || topology == "star" || topology == "regions",
+	                     "Unknown topology " << topology);
+	NS_ABORT_MSG_UNLESS (crossFlows == 0 || topology == "dumbbell", "Cross traffic needs the dumbbell");
+	NS_ABORT_MSG_UNLESS (!distributed || topology == "regions", "Only the regions topology is distributed");
+
+	// Every process builds the whole topology; systemId tells it which nodes are its own
+	uint32_t systemId = 0;
+	uint32_t nSystems = 1;
+	std::string rank = "";
+	if (distributed) {
+#ifdef NS3_MPI
+		GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DistributedSimulatorImpl"));
+		MpiInterface::Enable (&argc, &argv);
+		systemId = MpiInterface::GetSystemId ();
+		nSystems = MpiInterface::GetSize ();
+		std::ostringstream suffix;
+		suffix << "-rank-" << systemId;
+		rank = suffix.str ();
+#else
+		NS_FATAL_ERROR ("--distributed needs ns-3 configured with --enable-mpi");
+#endif
+	}
 
 	std::string errorModelType = "ns3::RateErrorModel";
-	Config::SetDefault ("ns3::RateErrorModel::ErrorRate", DoubleValue (0.001));
+	Config::SetDefault ("ns3::RateErrorModel::ErrorRate", DoubleValue (errorRate));
 	Config::SetDefault ("ns3::RateErrorModel::ErrorUnit", StringValue ("ERROR_UNIT_PACKET"));
 
 	PointToPointHelper p2p;
-	p2p.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
-	p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+	p2p.SetDeviceAttribute("DataRate", StringValue(dataRate));
+	p2p.SetChannelAttribute("Delay", StringValue(delay));
+
+	ReliableUdpServerHelper rserver(9);
+	rserver.SetAttribute("CongestionControl", TypeIdValue(TypeId::LookupByName(congestionControl)));
+	rserver.SetAttribute("FecMode", StringValue(fecMode));
+	rserver.SetAttribute("ReliabilityMode", StringValue(reliabilityMode));
+	rserver.SetAttribute("BitrateLadder", StringValue(bitrateLadder));
+	rserver.SetAttribute("AbrPolicy", TypeIdValue(TypeId::LookupByName(abrPolicy)));
+	if (frameTrace.empty ()) {
+		Config::SetDefault ("ns3::ReliableUdpGopFrameSource::Bitrate", DataRateValue (DataRate (videoBitrate)));
+	} else {
+		Config::SetDefault ("ns3::ReliableUdpTraceFrameSource::TraceFile", StringValue (frameTrace));
+		rserver.SetAttribute("FrameSource", TypeIdValue(ReliableUdpTraceFrameSource::GetTypeId()));
+	}
+	ReliableUdpClientHelper rclient;
+	rclient.SetAttribute("ReliabilityMode", StringValue(reliabilityMode));
+	ApplicationContainer serverApps;
+	ApplicationContainer clientApps;
+	ApplicationContainer crossSinks;
+	std::vector<uint32_t> flowIds; // Index of each client of clientApps among the clients of all processes
+	ObjectFactory factory;
+	factory.SetTypeId (errorModelType);
+	if (topology == "p2p") {
+		NodeContainer nodes;
+		nodes.Create(2);
 
-	NetDeviceContainer devices;
-	devices = p2p.Install(nodes);
+		NetDeviceContainer devices;
+		devices = p2p.Install(nodes);
 
-	InternetStackHelper stack;
-	stack.Install(nodes);
+		InternetStackHelper stack;
+		stack.Install(nodes);
 
-	Ipv4AddressHelper addr;
-	addr.SetBase("10.1.1.0", "255.255.255.0");
-	Ipv4InterfaceContainer interfaces = addr.Assign(devices);
+		Ipv4AddressHelper addr;
+		addr.SetBase("10.1.1.0", "255.255.255.0");
+		Ipv4InterfaceContainer interfaces = addr.Assign(devices);
 
-	ReliableUdpClientHelper rclient(interfaces.GetAddress(1), 9);
-	//rclient.SetAttribute("MaxPackets", UintegerValue(100000));
-	//rclient.SetAttribute("Interval", TimeValue(Seconds(0.1)));
-	//rclient.SetAttribute("PacketSize", UintegerValue(1024));
+		rclient.SetAttribute("RemoteAddress", AddressValue(interfaces.GetAddress(1)));
+		rclient.SetAttribute("RemotePort", UintegerValue(9));
+		for (uint32_t i = 0; i < nClients; i++) {
+			clientApps.Add(rclient.Install(nodes.Get(0)));
+		}
+		serverApps.Add(rserver.Install(nodes.Get(1)));
 
-	ApplicationContainer clientApps;
-	clientApps.Add(rclient.Install(nodes.Get(0)));
+		Ptr<ErrorModel> em = factory.Create<ErrorModel> ();
+		devices.Get (1)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+	} else if (topology == "regions") {
+		PointToPointHelper access;
+		access.SetDeviceAttribute("DataRate", StringValue(accessRate));
+		access.SetChannelAttribute("Delay", StringValue("1ms"));
+		ReliableUdpRegionsHelper regions (nRegions, nClients, access, p2p, nSystems, systemId);
+		serverApps.Add(regions.InstallServers(rserver));
+		clientApps.Add(regions.InstallClients(rclient, 9));
+		// Streams go by client and region rather than by creation order, so that
+		// every process draws what a sequential run does
+		for (uint32_t i = 0; i < nClients; i++) {
+			Ptr<RateErrorModel> em = factory.Create<RateErrorModel> ();
+			em->AssignStreams (i);
+			regions.GetClientDevice (i)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+			if (regions.IsLocalClient (i)) {
+				flowIds.push_back (i);
+			}
+		}
+		regions.AssignStreams (nClients);
+	} else {
+		if (topology == "dumbbell") {
+			PointToPointHelper access;
+			access.SetDeviceAttribute("DataRate", StringValue(accessRate));
+			access.SetChannelAttribute("Delay", StringValue("1ms"));
+			ReliableUdpDumbbellHelper dumbbell (nClients, crossFlows, access, p2p);
+			serverApps.Add(dumbbell.InstallServers(rserver));
+			clientApps.Add(dumbbell.InstallClients(rclient, 9));
+			crossSinks.Add(dumbbell.InstallCrossTraffic(5000, Seconds(startTime), Seconds(stopTime)));
+		} else {
+			ReliableUdpStarHelper star (nClients, p2p);
+			serverApps.Add(star.InstallServer(rserver));
+			clientApps.Add(star.InstallClients(rclient, 9));
+		}
+		// Every client has a single link, device 0 of its node
+		for (uint32_t i = 0; i < clientApps.GetN (); i++) {
+			Ptr<ErrorModel> em = factory.Create<ErrorModel> ();
+			clientApps.Get (i)->GetNode ()->GetDevice (0)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+		}
+	}
+	for (uint32_t i = flowIds.size (); i < clientApps.GetN (); i++) {
+		flowIds.push_back (i);
+	}
 	clientApps.Start(Seconds(0.0));
-	clientApps.Stop(Seconds(10.0));
+	clientApps.Stop(Seconds(stopTime + 1));
+	serverApps.Start(Seconds(startTime));
+	serverApps.Stop(Seconds(stopTime));
 
-	ReliableUdpServerHelper rserver(9);
-	ApplicationContainer serverApps(rserver.Install(nodes.Get(1)));
-	serverApps.Start(Seconds(1.0));
-	serverApps.Stop(Seconds(9.0));
+	// Extra streams join running sessions; stream i gets weight i + 1, stream 0 weight 1
+	ObjectFactory streamFactory;
+	streamFactory.SetTypeId (frameTrace.empty () ? ReliableUdpGopFrameSource::GetTypeId () : ReliableUdpTraceFrameSource::GetTypeId ());
+	for (uint32_t j = 0; j < serverApps.GetN (); j++) {
+		Ptr<ReliableUdpServer> server = DynamicCast<ReliableUdpServer> (serverApps.Get (j));
+		for (uint32_t i = 1; i < nStreams; i++) {
+			Simulator::Schedule (Seconds (startTime + i), &ReliableUdpServer::AddStream, server, streamFactory, i + 1);
+		}
+	}
 
-	ObjectFactory factory;
-	factory.SetTypeId (errorModelType);
-	Ptr<ErrorModel> em = factory.Create<ErrorModel> ();
-	devices.Get (1)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+	if (pcap) {
+		p2p.EnablePcapAll("master" + rank, false);
+	}
+
+	if (!eventTrace.empty ()) {
+		for (uint32_t i = 0; i < serverApps.GetN (); i++) {
+			std::ostringstream name;
+			name << eventTrace << rank << "-server-" << i << ".bin";
+			serverApps.Get (i)->SetAttribute ("EventTrace", StringValue (name.str ()));
+		}
+		for (uint32_t i = 0; i < clientApps.GetN (); i++) {
+			std::ostringstream name;
+			name << eventTrace << "-client-" << flowIds[i] << ".bin";
+			clientApps.Get (i)->SetAttribute ("EventTrace", StringValue (name.str ()));
+		}
+	}
 
-	p2p.EnablePcapAll("master", false);
+	ReliableUdpStatsHelper statsHelper;
+	if (!stats.empty ()) {
+		statsHelper.Add (serverApps);
+		statsHelper.Add (clientApps);
+		statsHelper.Start (Seconds (startTime));
+		statsHelper.Stop (Seconds (stopTime + 1));
+	}
 
-	Simulator::Stop (Seconds (20));
+	if (!result.empty ()) {
+		g_bytesDelivered.resize (clientApps.GetN (), 0);
+		for (uint32_t i = 0; i < clientApps.GetN (); i++) {
+			clientApps.Get (i)->TraceConnectWithoutContext ("Delay", MakeCallback (&RecordDelay));
+			clientApps.Get (i)->TraceConnectWithoutContext ("RecoveryLatency", MakeCallback (&RecordRecovery));
+			clientApps.Get (i)->TraceConnectWithoutContext ("AcksSent", MakeBoundCallback (&CountPackets, &g_acksSent));
+			clientApps.Get (i)->TraceConnectWithoutContext ("BytesDelivered",
+			                                                MakeBoundCallback (&AddBytesDelivered, &g_bytesDelivered[i]));
+		}
+		for (uint32_t i = 0; i < serverApps.GetN (); i++) {
+			serverApps.Get (i)->TraceConnectWithoutContext ("PacketsSent", MakeBoundCallback (&CountPackets, &g_packetsSent));
+			serverApps.Get (i)->TraceConnectWithoutContext ("PacketsRetransmitted",
+			                                                MakeBoundCallback (&CountPackets, &g_packetsRetransmitted));
+		}
+	}
+
+	Simulator::Stop (Seconds (stopTime + 11));
+	std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now ();
 	Simulator::Run ();
+	double wallClock = std::chrono::duration<double> (std::chrono::steady_clock::now () - wallStart).count ();
+	// Applications run until the clients stop; an idle tail adds no events
+	uint64_t events = Simulator::GetEventCount ();
+	NS_LOG_INFO (events << " events, " << events / (stopTime + 1) << " per simulated second, in " << wallClock << "s");
+	if (!stats.empty ()) {
+		statsHelper.WriteCsv (stats + rank + ".csv");
+		statsHelper.WriteJson (stats + rank + ".json");
+	}
+#ifdef NS3_MPI
+	if (distributed && !result.empty ()) {
+		// Process 0 reports for all: per-client bytes by client index, summed
+		// counters, the slowest wall clock and every delay sample
+		std::vector<uint64_t> bytes (nClients, 0);
+		for (uint32_t i = 0; i < flowIds.size (); i++) {
+			bytes[flowIds[i]] = g_bytesDelivered[i];
+		}
+		g_bytesDelivered.assign (nClients, 0);
+		MPI_Reduce (bytes.data (), g_bytesDelivered.data (), nClients, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+		uint64_t counters[4] = {g_packetsSent, g_packetsRetransmitted, g_acksSent, events};
+		uint64_t totals[4] = {0, 0, 0, 0};
+		MPI_Reduce (counters, totals, 4, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+		g_packetsSent = totals[0];
+		g_packetsRetransmitted = totals[1];
+		g_acksSent = totals[2];
+		events = totals[3];
+		double localWallClock = wallClock;
+		MPI_Reduce (&localWallClock, &wallClock, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+		GatherSamples (g_delays, nSystems);
+		GatherSamples (g_recoveries, nSystems);
+	}
+#endif
+	if (!result.empty () && systemId == 0) {
+		double seconds = stopTime - startTime;
+		std::vector<double> flowGoodputs;
+		double goodput = 0;
+		for (uint32_t i = 0; i < g_bytesDelivered.size (); i++) {
+			flowGoodputs.push_back (g_bytesDelivered[i] * 8 / seconds);
+			goodput += flowGoodputs.back ();
+		}
+		double crossGoodput = 0;
+		for (uint32_t i = 0; i < crossSinks.GetN (); i++) {
+			crossGoodput += DynamicCast<PacketSink> (crossSinks.Get (i))->GetTotalRx () * 8 / seconds;
+		}
+
+		std::ofstream out (result.c_str ());
+		NS_ABORT_MSG_UNLESS (out, "Cannot open " << result);
+		out << "{\"topology\": \"" << topology << "\", \"crossFlows\": " << crossFlows
+		    << ", \"dataRate\": \"" << dataRate << "\", \"delay\": \"" << delay
+		    << "\", \"errorRate\": " << errorRate
+		    << ", \"congestionControl\": \"" << congestionControl << "\", \"fecMode\": \"" << fecMode
+		    << "\", \"reliabilityMode\": \"" << reliabilityMode
+		    << "\", \"nClients\": " << nClients << ", \"nStreams\": " << nStreams
+		    << ", \"nRegions\": " << nRegions << ", \"ranks\": " << nSystems
+		    << ", \"run\": " << RngSeedManager::GetRun ()
+		    << ", \"goodput\": " << goodput
+		    << ", \"jainIndex\": " << JainIndex (flowGoodputs)
+		    << ", \"crossTrafficGoodput\": " << crossGoodput
+		    << ", \"delayP50\": " << Percentile (g_delays, 50)
+		    << ", \"delayP95\": " << Percentile (g_delays, 95)
+		    << ", \"delayP99\": " << Percentile (g_delays, 99)
+		    << ", \"retransmissionRatio\": " << (g_packetsSent > 0 ? double (g_packetsRetransmitted) / g_packetsSent : 0)
+		    << ", \"reversePackets\": " << g_acksSent
+		    << ", \"recoveryP50\": " << Percentile (g_recoveries, 50)
+		    << ", \"recoveryP95\": " << Percentile (g_recoveries, 95)
+		    << ", \"wallClock\": " << wallClock
+		    << ", \"events\": " << events
+		    << ", \"eventsPerSimSecond\": " << events / (stopTime + 1)
+		    << ", \"flowGoodputs\": [";
+		for (uint32_t i = 0; i < flowGoodputs.size (); i++) {
+			out << (i > 0 ? ", " : "") << flowGoodputs[i];
+		}
+		out << "]}" << std::endl;
+	}
 	Simulator::Destroy ();
+#ifdef NS3_MPI
+	if (distributed) {
+		MpiInterface::Disable ();
+	}
+#endif
 
 }
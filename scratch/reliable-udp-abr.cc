@@ -0,0 +1,121 @@
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "reliable-udp-abr.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpAbr");
+
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpAbr);
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpThroughputAbr);
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpBufferAbr);
+
+TypeId
+ReliableUdpAbr::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpAbr")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    ;
+  return tid;
+}
+
+ReliableUdpAbr::~ReliableUdpAbr ()
+{
+}
+
+/* ReliableUdpThroughputAbr */
+
+TypeId
+ReliableUdpThroughputAbr::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpThroughputAbr")
+    .SetParent<ReliableUdpAbr> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpThroughputAbr> ()
+    .AddAttribute ("Safety", "Fraction of the throughput the selected bitrate may use",
+                   DoubleValue (0.8),
+                   MakeDoubleAccessor (&ReliableUdpThroughputAbr::m_safety),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("Alpha", "Weight of a new sample in the smoothed throughput",
+                   DoubleValue (0.3),
+                   MakeDoubleAccessor (&ReliableUdpThroughputAbr::m_alpha),
+                   MakeDoubleChecker<double> (0, 1))
+    ;
+  return tid;
+}
+
+ReliableUdpThroughputAbr::ReliableUdpThroughputAbr ()
+  : m_safety (0.8),
+    m_alpha (0.3),
+    m_throughput (0)
+{
+}
+
+uint32_t
+ReliableUdpThroughputAbr::SelectRung (const std::vector<DataRate> &ladder, uint32_t current,
+                                      const Status &status)
+{
+  double sample = status.throughput.GetBitRate ();
+  m_throughput = m_throughput == 0 ? sample : (1 - m_alpha) * m_throughput + m_alpha * sample;
+
+  double budget = m_safety * m_throughput * (1 - std::min (status.lossRate, 1.0));
+  uint32_t rung = 0;
+  while (rung + 1 < ladder.size () && ladder[rung + 1].GetBitRate () <= budget) {
+    rung++;
+  }
+  NS_LOG_DEBUG ("Throughput " << m_throughput << " bit/s, loss " << status.lossRate
+                << "; rung " << rung);
+  return std::min (rung, current + 1);
+}
+
+/* ReliableUdpBufferAbr */
+
+TypeId
+ReliableUdpBufferAbr::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpBufferAbr")
+    .SetParent<ReliableUdpAbr> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpBufferAbr> ()
+    .AddAttribute ("Reservoir", "Buffer level under which the lowest bitrate is used",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&ReliableUdpBufferAbr::m_reservoir),
+                   MakeTimeChecker ())
+    .AddAttribute ("Cushion", "Buffer range over which the bitrate climbs from lowest to highest",
+                   TimeValue (Seconds (4)),
+                   MakeTimeAccessor (&ReliableUdpBufferAbr::m_cushion),
+                   MakeTimeChecker ())
+    ;
+  return tid;
+}
+
+ReliableUdpBufferAbr::ReliableUdpBufferAbr ()
+  : m_reservoir (Seconds (1)),
+    m_cushion (Seconds (4))
+{
+}
+
+uint32_t
+ReliableUdpBufferAbr::SelectRung (const std::vector<DataRate> &ladder, uint32_t current,
+                                  const Status &status)
+{
+  if (status.bufferLevel <= m_reservoir) {
+    return 0;
+  }
+  if (status.bufferLevel >= m_reservoir + m_cushion) {
+    return ladder.size () - 1;
+  }
+  double f = (status.bufferLevel - m_reservoir).GetSeconds () / m_cushion.GetSeconds ();
+  double low = ladder.front ().GetBitRate ();
+  double target = low + f * (ladder.back ().GetBitRate () - low);
+  uint32_t rung = 0;
+  while (rung + 1 < ladder.size () && ladder[rung + 1].GetBitRate () <= target) {
+    rung++;
+  }
+  NS_LOG_DEBUG ("Buffer " << status.bufferLevel.GetSeconds () << "s; rung " << rung);
+  return rung;
+}
+
+} // namespace ns3
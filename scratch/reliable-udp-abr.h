@@ -0,0 +1,100 @@
+#ifndef RELIABLE_UDP_ABR_H
+#define RELIABLE_UDP_ABR_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Adaptive bitrate policy of ReliableUdpServer.
+ *
+ * Every AbrInterval the session measures a stream and asks its policy which 
+ * rung of the bitrate ladder to encode the stream at next. The frame source 
+ * of the stream is switched when the answer differs from the current rung.
+ * The implementation is selected by the AbrPolicy attribute of the server.
+ */
+class ReliableUdpAbr : public Object
+{
+public:
+  /// What the session measured over the last interval
+  struct Status
+  {
+    DataRate throughput;  //!< Share of the path capacity estimate the stream may use 
+    DataRate goodput;     //!< Rate of the bytes of the stream acked 
+    double lossRate;      //!< Lost packets over sent packets 
+    Time rtt;             //!< Smoothed RTT 
+    Time bufferLevel;     //!< Play time buffered by the client, from its last ack 
+  };
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual ~ReliableUdpAbr ();
+
+  /**
+   * \param ladder encoding bitrates, in increasing order
+   * \param current index of the rung the stream is encoded at
+   * \param status measurements of the last interval
+   * \return index of the rung to encode at next
+   */
+  virtual uint32_t SelectRung (const std::vector<DataRate> &ladder, uint32_t current,
+                               const Status &status) = 0;
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Throughput-based policy.
+ *
+ * It picks the highest rung below a safety fraction of the smoothed 
+ * throughput, discounted by the loss rate. It climbs one rung at a time, 
+ * so a single optimistic sample cannot overshoot the path.
+ */
+class ReliableUdpThroughputAbr : public ReliableUdpAbr
+{
+public:
+  static TypeId GetTypeId (void);
+  ReliableUdpThroughputAbr ();
+
+  virtual uint32_t SelectRung (const std::vector<DataRate> &ladder, uint32_t current,
+                               const Status &status);
+
+private:
+  double m_safety;          //!< Fraction of the throughput a rung may use 
+  double m_alpha;           //!< Weight of a new sample in the smoothed throughput 
+  double m_throughput;      //!< Smoothed throughput in bit/s; 0 before the first sample 
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Buffer-based policy, as BBA-0.
+ *
+ * The rung follows the buffer level of the client alone: the lowest rung 
+ * while the buffer is below Reservoir, the highest once it exceeds 
+ * Reservoir + Cushion, and a linear map in between. A draining buffer is 
+ * what throughput estimates fail to predict, so it reacts to it directly.
+ */
+class ReliableUdpBufferAbr : public ReliableUdpAbr
+{
+public:
+  static TypeId GetTypeId (void);
+  ReliableUdpBufferAbr ();
+
+  virtual uint32_t SelectRung (const std::vector<DataRate> &ladder, uint32_t current,
+                               const Status &status);
+
+private:
+  Time m_reservoir;         //!< Buffer level under which the lowest rung is used 
+  Time m_cushion;           //!< Buffer range mapped over the ladder 
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_ABR_H */
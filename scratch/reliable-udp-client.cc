@@ -8,7 +8,11 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
-#include "ns3/drop-tail-queue.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include <cmath>
 #include "reliable-udp-client.h"
 
 namespace ns3 {
@@ -31,16 +35,181 @@ TypeId ReliableUdpClient::GetTypeId (void)
                    UintegerValue (100),
                    MakeUintegerAccessor (&ReliableUdpClient::m_peerPort),
                    MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("HelloInterval", "Time between hellos until the server starts streaming",
+                   TimeValue (MilliSeconds (500)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_helloInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("SilenceTimeout",
+                   "Time without any packet from the server after which the client acks stream 0 to "
+                   "find out whether its session still exists, and again every SilenceTimeout after that",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_silenceTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("ReorderWindow", "Number of packets the reorder window of a stream can hold",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&ReliableUdpClient::m_reorderWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("AckEveryN", "Number of received packets acknowledged by one ack",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&ReliableUdpClient::m_ackEveryN),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("DelayedAckTimeout", "Max time an ack is delayed to coalesce it with others",
+                   TimeValue (MilliSeconds (5)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_ackDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("ReliabilityMode",
+                   "How losses are reported: Ack, by acks of every AckEveryN packets with SACKs, or Nack, "
+                   "by NACKs of the gaps and at most one ack per FeedbackInterval. The server must use the same mode.",
+                   EnumValue (ReliableUdpHeader::ACK_MODE),
+                   MakeEnumAccessor (&ReliableUdpClient::m_reliabilityMode),
+                   MakeEnumChecker (ReliableUdpHeader::ACK_MODE, "Ack",
+                                    ReliableUdpHeader::NACK_MODE, "Nack"))
+    .AddAttribute ("FeedbackInterval", "Time an ack waits in Nack mode for more packets to ack",
+                   TimeValue (MilliSeconds (50)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_feedbackInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("NackInterval", "Min time between NACKs of a stream; gaps found meanwhile go in the next",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_nackInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("NackRetryTimeout",
+                   "Time before a packet still missing is NACKed again, until the NACK round trip is measured",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_nackRetryTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("FecHistory", "Number of recent data packets kept to decode FEC blocks",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&ReliableUdpClient::m_fecHistory),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("FecSymbolSize", "Max size of a FEC symbol: a payload plus 19 bytes of header fields",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&ReliableUdpClient::m_fecSymbolSize),
+                   MakeUintegerChecker<uint32_t> (20))
+    .AddAttribute ("FrameRate", "Frames played per second; at least 1",
+                   DoubleValue (30),
+                   MakeDoubleAccessor (&ReliableUdpClient::m_frameRate),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("Prebuffer", "Min play time buffered before playback starts or resumes",
+                   TimeValue (MilliSeconds (200)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_prebuffer),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxBufferDepth", "Max play time the playout buffer waits for before (re)starting",
+                   TimeValue (Seconds (2)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_maxBufferDepth),
+                   MakeTimeChecker ())
+    .AddAttribute ("PlayoutCapacity", "Max play time the playout buffer holds; it bounds the advertised window",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&ReliableUdpClient::m_playoutCapacity),
+                   MakeTimeChecker ())
+    .AddAttribute ("JitterFactor", "Target depth of the playout buffer in multiples of the frame jitter",
+                   DoubleValue (4),
+                   MakeDoubleAccessor (&ReliableUdpClient::m_jitterFactor),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("EventTrace",
+                   "File to record per-packet events to, in the format of ReliableUdpEventRecorder; "
+                   "empty records none",
+                   StringValue (""),
+                   MakeStringAccessor (&ReliableUdpClient::m_eventTrace),
+                   MakeStringChecker ())
+    .AddAttribute ("EventBufferSize", "Number of events buffered before they are written to the EventTrace file",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&ReliableUdpClient::m_eventBufferSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("TargetDepth",
+                     "Buffered play time needed to start or resume playback of the stream updated last.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_targetDepth),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("Rebuffering",
+                     "Number of times playback stalled after it started.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_rebuffers),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("Stall",
+                     "Duration of a stall, fired when playback resumes.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_stallTrace),
+                     "ns3::Time::TracedCallback")
+    .AddTraceSource ("StartupDelay",
+                     "Time from the first packet to the first frame played.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_startupTrace),
+                     "ns3::Time::TracedCallback")
+    .AddTraceSource ("Delay",
+                     "One-way delay of a data packet, from its latest transmission to its arrival.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_delayTrace),
+                     "ns3::Time::TracedCallback")
+    .AddTraceSource ("LateFrames",
+                     "Number of frames played after their deadline.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_lateFrames),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("FecRecovered",
+                     "Number of lost packets rebuilt from FEC parity.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_fecRecovered),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("FecUnrecovered",
+                     "Number of packets missing from FEC blocks given up on; "
+                     "with FecRecovered it gives the recovery ratio.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_fecUnrecovered),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("AcksSent",
+                     "Number of acks sent to the server, NACKs included.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_acksSent),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("NacksSent",
+                     "Number of NACKs sent to the server.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_nacksSent),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("RecoveryLatency",
+                     "Time from finding a data packet missing to its arrival, resent or rebuilt from FEC parity.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_recoveryTrace),
+                     "ns3::Time::TracedCallback")
+    .AddTraceSource ("PacketsReceived",
+                     "Number of data packets received, duplicates included.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_packetsReceived),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("Duplicates",
+                     "Number of data packets received more than once.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_duplicates),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("Reordered",
+                     "Number of data packets received while an earlier one was missing.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_reordered),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("PacketsDropped",
+                     "Number of packets dropped beyond the reorder window or of another header version.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_packetsDropped),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("BytesDelivered",
+                     "Payload bytes delivered in order to the frame assembler.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_bytesDelivered),
+                     "ns3::TracedValueCallback::Uint64")
+    .AddTraceSource ("ReorderBuffer",
+                     "Packets held in the reorder windows of all streams.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_reorderBufferPackets),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("InOrderQueue",
+                     "Frames waiting in the in-order queues of all streams.",
+                     MakeTraceSourceAccessor (&ReliableUdpClient::m_inOrderFrames),
+                     "ns3::TracedValueCallback::Uint32")
     ;
     return tid;
 }
 
+ReliableUdpClient::Stream::Stream ()
+  : id (0),
+    forwardSeq (0),
+    fragmentsReceived (0),
+    pendingAcks (0),
+    playing (false),
+    started (false),
+    packetsPerFrame (1),
+    advertisedEdge (0),
+    timestampRecent (0),
+    receivedEdge (0)
+{
+}
+
 ReliableUdpClient::ReliableUdpClient ()
 {
-  m_receiving = true;
   m_socket = 0;
-  m_lastArrangedSeq = 0;
-  m_outOfOrderQueue = m_inOrderQueue = 0;
+  m_firstPacketTime = Seconds (-1);
 }
 
 ReliableUdpClient::~ReliableUdpClient ()
@@ -63,18 +232,21 @@ ReliableUdpClient::SetRemote (Address addr)
 void 
 ReliableUdpClient::DoDispose (void)
 {
+  m_recorder = 0;
   Application::DoDispose ();
 }
 
 void
 ReliableUdpClient::StartApplication (void)
 {
-  if (m_outOfOrderQueue == 0) 
-    m_outOfOrderQueue = CreateObject<DropTailQueue<Packet> > ();
-  if (m_inOrderQueue == 0)
-    m_inOrderQueue = CreateObject<DropTailQueue<Packet> > ();
+  m_targetDepth = m_prebuffer;
+  if (!m_eventTrace.empty () && m_recorder == 0) {
+    m_recorder = Create<ReliableUdpEventRecorder> ();
+    m_recorder->Open (m_eventTrace, m_eventBufferSize);
+  }
 
-  InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), 9);
+  // Any local port will do; the server answers the address the hello came from 
+  InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), 0);
   if (m_socket == 0) {
     TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
     m_socket = Socket::CreateSocket (GetNode (), tid);
@@ -95,22 +267,35 @@ ReliableUdpClient::StartApplication (void)
   }
 
   m_socket->SetRecvCallback (MakeCallback (&ReliableUdpClient::HandleRead, this));
-  m_outOfOrderQueue->SetMaxSize (QueueSize (ns3::BYTES, MAX_QUEUE_SIZE));
-  m_rearrangePacketsEvent = Simulator::Schedule (
-    MilliSeconds(10), 
-    &ReliableUdpClient::RearrangePackets, this
-  );
-  m_consumePacketsEvent = Simulator::Schedule (
-    MilliSeconds(33),
-    &ReliableUdpClient::ConsumePackets, this
-  );
+  SendHello ();
 }
 
 void
 ReliableUdpClient::StopApplication (void) 
 {
-  Simulator::Cancel (m_rearrangePacketsEvent);
-  Simulator::Cancel (m_consumePacketsEvent);
+  Simulator::Cancel (m_helloEvent);
+  Simulator::Cancel (m_silenceEvent);
+  CancelStreams ();
+  if (m_recorder != 0) {
+    m_recorder->Close ();
+  }
+}
+
+ReliableUdpClient::Stream &
+ReliableUdpClient::GetStream (uint16_t streamId)
+{
+  std::map<uint16_t, Stream>::iterator it = m_streams.find (streamId);
+  if (it != m_streams.end ()) {
+    return it->second;
+  }
+  NS_LOG_INFO ("Stream " << streamId << " starts");
+  Stream &s = m_streams[streamId];
+  s.id = streamId;
+  s.reorderBuffer.SetCapacity (m_reorderWindow);
+  s.missing.resize (m_reorderWindow);
+  s.fecDecoder.Configure (m_fecHistory, m_fecSymbolSize);
+  s.targetDepth = m_prebuffer;
+  return s;
 }
 
 void
@@ -120,117 +305,551 @@ ReliableUdpClient::HandleRead (Ptr<Socket> socket)
   Address from;
   while ((packet = socket->RecvFrom (from))) {
     if (packet->GetSize () > 0) {
-      // If packet arrives while incoming is blocked,
-      // resend stop request 
-      if (!m_receiving) {
-        SendAck (0, 0x01);
-        return;
-      }
+      // The header stays on the packet until it is reassembled 
       ReliableUdpHeader recvHeader;
-      packet->RemoveHeader (recvHeader);
-      uint8_t isRetransmit = recvHeader.GetRetransmit();
-      uint32_t seq = recvHeader.GetSeqNum();
-
-      // As retransmit queue sorts packets using info in header, 
-      // we should re-attach it. 
-      packet->AddHeader (recvHeader);
-
-      uint8_t signal = 0x00;
-      // For retransmitted packets, push into retransmit queue 
-      if (isRetransmit) {
-        m_retransQueue.push(packet);
-        std::cout << "ret " << seq << std::endl;
-      // For regular packets, push into out-of-order queue 
+      packet->PeekHeader (recvHeader);
+      if (recvHeader.GetVersion () != ReliableUdpHeader::VERSION) {
+        NS_LOG_WARN ("Drop packet of header version " << (uint32_t) recvHeader.GetVersion ());
+        m_packetsDropped++;
+        continue;
+      }
+      if (recvHeader.GetFlags () & ReliableUdpHeader::FLAG_HELLO) {
+        // The server has no session for us; the streams start over. While 
+        // hellos are out, older packets may still be answered this way 
+        if (m_firstPacketTime.IsNegative ()) {
+          continue;
+        }
+        NS_LOG_INFO ("Session lost, reconnecting");
+        CancelStreams ();
+        m_streams.clear ();
+        m_firstPacketTime = Seconds (-1);
+        Simulator::Cancel (m_helloEvent);
+        SendHello ();
+        continue;
+      }
+      m_lastPacketTime = Simulator::Now ();
+      if (m_firstPacketTime.IsNegative ()) {
+        m_firstPacketTime = Simulator::Now ();
+        Simulator::Cancel (m_helloEvent);
+        if (!m_silenceEvent.IsRunning ()) {
+          m_silenceEvent = Simulator::Schedule (m_silenceTimeout, &ReliableUdpClient::CheckSession, this);
+        }
+      }
+      Stream &s = GetStream (recvHeader.GetStreamId ());
+      if (int32_t (recvHeader.GetForwardSeq () - s.forwardSeq) > 0) {
+        s.forwardSeq = recvHeader.GetForwardSeq ();
+      }
+      // Following Karn's rule, acks of retransmissions are not sampled 
+      s.timestampRecent = recvHeader.GetRetransmit () ? 0 : recvHeader.GetTimestamp ();
+      s.timestampArrival = Simulator::Now ();
+      if (recvHeader.GetFlags () & ReliableUdpHeader::FLAG_PROBE) {
+        // The server sees a closed window; tell it the current one 
+        SendAck (s.id);
+        continue;
+      }
+      if (recvHeader.GetFlags () & ReliableUdpHeader::FLAG_KEEPALIVE) {
+        // Whatever was sent up to the next seq # and not received is lost 
+        MarkMissing (s, recvHeader.GetNextSeq ());
+        RearrangePackets (s.id);
+        // The server still waits for acks; the last one may have been lost 
+        ScheduleFeedback (s);
+        continue;
+      }
+
+      bool immediate = false;
+      bool inserted = false;
+      std::vector<Ptr<Packet> > recovered;
+      uint32_t fecRecovered = s.fecDecoder.GetRecovered ();
+      uint32_t fecUnrecovered = s.fecDecoder.GetUnrecovered ();
+      if (recvHeader.IsParity ()) {
+        if (m_recorder != 0) {
+          m_recorder->Record (ReliableUdpEventRecorder::RX_PARITY, s.id, recvHeader.GetSeqNum (), packet->GetSize ());
+        }
+        s.fecDecoder.AddParity (packet, recovered);
       } else {
-        if (false) {
-          m_receiving = false;
-          signal = 0x01;
-        } else {
-          m_outOfOrderQueue->Enqueue(packet);
-          std::cout << "reg " << seq << std::endl;
+        m_packetsReceived++;
+        if (recvHeader.GetTimestamp () != 0) {
+          // Both ends run on the simulator clock; the subtraction wraps like the timestamp 
+          uint32_t now = uint32_t (Simulator::Now ().GetMicroSeconds ());
+          m_delayTrace (MicroSeconds (uint32_t (now - recvHeader.GetTimestamp ())));
+        }
+        inserted = InsertPacket (s, packet, immediate);
+        s.fecDecoder.AddData (packet, recovered);
+      }
+      for (uint32_t i = 0; i < recovered.size (); i++) {
+        if (m_recorder != 0) {
+          ReliableUdpHeader header;
+          recovered[i]->PeekHeader (header);
+          m_recorder->Record (ReliableUdpEventRecorder::FEC_RECOVERED, s.id, header.GetSeqNum (), recovered[i]->GetSize ());
         }
+        inserted = InsertPacket (s, recovered[i], immediate) || inserted;
+      }
+      if (s.fecDecoder.GetRecovered () != fecRecovered) {
+        m_fecRecovered = m_fecRecovered + s.fecDecoder.GetRecovered () - fecRecovered;
+      }
+      if (s.fecDecoder.GetUnrecovered () != fecUnrecovered) {
+        m_fecUnrecovered = m_fecUnrecovered + s.fecDecoder.GetUnrecovered () - fecUnrecovered;
+      }
+      if (!inserted) {
+        continue;
+      }
+
+      RearrangePackets (s.id);
+      if (m_reliabilityMode == ReliableUdpHeader::NACK_MODE) {
+        // Gaps were NACKed as they were found 
+        ScheduleFeedback (s);
+      } else {
+        UpdateAckState (s, immediate);
+      }
+    }
+  }
+}
+
+bool
+ReliableUdpClient::InsertPacket (Stream &s, Ptr<Packet> packet, bool &immediate)
+{
+  ReliableUdpHeader header;
+  packet->PeekHeader (header);
+  uint8_t isRetransmit = header.GetRetransmit ();
+  uint32_t seq = header.GetSeqNum ();
+
+  // Regular, retransmitted and rebuilt packets share the reorder window 
+  uint32_t expected = s.reorderBuffer.GetNextExpected ();
+  bool hadGap = s.reorderBuffer.GetNPackets () > 0;
+  ReliableUdpReorderBuffer::InsertResult result = s.reorderBuffer.Insert (seq, packet);
+  if (result == ReliableUdpReorderBuffer::OUT_OF_WINDOW) {
+    // No room; leave it unacked so that the server resends it later 
+    m_packetsDropped++;
+    if (m_recorder != 0) {
+      m_recorder->Record (ReliableUdpEventRecorder::RX_DROP, s.id, seq, packet->GetSize (),
+                          isRetransmit ? ReliableUdpEventRecorder::RETRANSMIT : 0);
+    }
+    return false;
+  }
+  uint8_t flags = isRetransmit ? ReliableUdpEventRecorder::RETRANSMIT : 0;
+  if (result == ReliableUdpReorderBuffer::DUPLICATE) {
+    m_duplicates++;
+    flags |= ReliableUdpEventRecorder::DUPLICATE;
+  } else if (result == ReliableUdpReorderBuffer::SKIPPED) {
+    flags |= ReliableUdpEventRecorder::SKIPPED;
+  } else if (seq != expected) {
+    m_reordered++;
+    flags |= ReliableUdpEventRecorder::OUT_OF_ORDER;
+  }
+  if (m_recorder != 0) {
+    m_recorder->Record (ReliableUdpEventRecorder::RX_DATA, s.id, seq, packet->GetSize (), flags);
+  }
+  if (result == ReliableUdpReorderBuffer::INSERTED) {
+    if (int32_t (seq - s.receivedEdge) >= 0) {
+      MarkMissing (s, seq);
+      s.receivedEdge = seq + 1;
+    } else {
+      // It fills a gap 
+      MissingPacket &m = s.missing[seq % s.missing.size ()];
+      Time now = Simulator::Now ();
+      m_recoveryTrace (now - m.detected);
+      if (isRetransmit && !m.nacked.IsZero ()) {
+        Time sample = now - m.nacked;
+        s.nackRtt = s.nackRtt.IsZero () ? sample
+          : Seconds (0.875 * s.nackRtt.GetSeconds () + 0.125 * sample.GetSeconds ());
       }
-      SendAck (recvHeader.GetSeqNum (), signal); 
     }
   }
+
+  immediate = immediate || result == ReliableUdpReorderBuffer::DUPLICATE || seq != expected || hadGap;
+  return true;
+}
+
+void
+ReliableUdpClient::MarkMissing (Stream &s, uint32_t seq)
+{
+  uint32_t expected = s.reorderBuffer.GetNextExpected ();
+  if (int32_t (s.receivedEdge - expected) < 0) {
+    // Skipped gaps are no longer waited for 
+    s.receivedEdge = expected;
+  }
+  uint32_t end = expected + s.reorderBuffer.GetCapacity ();
+  if (int32_t (seq - end) > 0) {
+    seq = end;
+  }
+  if (int32_t (seq - s.receivedEdge) <= 0) {
+    return;
+  }
+  Time now = Simulator::Now ();
+  for (uint32_t k = s.receivedEdge; k != seq; k++) {
+    MissingPacket &m = s.missing[k % s.missing.size ()];
+    m.detected = now;
+    m.nacked = Seconds (0);
+  }
+  s.receivedEdge = seq;
+  if (m_reliabilityMode == ReliableUdpHeader::NACK_MODE) {
+    ScheduleNack (s, now);
+  }
+}
+
+void
+ReliableUdpClient::ScheduleNack (Stream &s, Time at)
+{
+  Time delay = std::max (at, s.lastNackTime + m_nackInterval) - Simulator::Now ();
+  if (delay.IsNegative ()) {
+    delay = Seconds (0);
+  }
+  if (s.nackEvent.IsRunning ()) {
+    if (Simulator::GetDelayLeft (s.nackEvent) <= delay) {
+      return;
+    }
+    Simulator::Cancel (s.nackEvent);
+  }
+  s.nackEvent = Simulator::Schedule (delay, &ReliableUdpClient::SendNack, this, s.id);
 }
 
 void
-ReliableUdpClient::RearrangePackets (void)
+ReliableUdpClient::SendNack (uint16_t streamId)
 {
-  // If enough room is made in out-of-order queue, 
-  // require to resume sending 
-  uint32_t queueSize = m_outOfOrderQueue->GetMaxSize().GetValue();
-  uint32_t occupied = m_outOfOrderQueue->GetNBytes();
-  if (!m_receiving && queueSize - occupied > 4096) {
-    m_receiving = true;
-    SendAck(0, 0x02);
+  Stream &s = GetStream (streamId);
+  Time now = Simulator::Now ();
+  Time retry = s.nackRtt.IsZero () ? m_nackRetryTimeout : Seconds (2 * s.nackRtt.GetSeconds ());
+  uint32_t seq = s.reorderBuffer.GetNextExpected ();
+  if (int32_t (s.forwardSeq - seq) > 0) {
+    seq = s.forwardSeq;
+  }
+  uint32_t base = 0;
+  uint64_t bitmap = 0;
+  uint32_t count = 0;
+  bool more = false;
+  Time nextRetry = Seconds (-1);
+  for (; int32_t (seq - s.receivedEdge) < 0; seq++) {
+    if (s.reorderBuffer.IsReceived (seq)) {
+      continue;
+    }
+    MissingPacket &m = s.missing[seq % s.missing.size ()];
+    if (!m.nacked.IsZero () && now - m.nacked < retry) {
+      // Its resend may still be on the way 
+      if (nextRetry.IsNegative () || m.nacked + retry < nextRetry) {
+        nextRetry = m.nacked + retry;
+      }
+      continue;
+    }
+    if (bitmap == 0) {
+      base = seq;
+    } else if (seq - base >= 64) {
+      more = true;
+      break;
+    }
+    bitmap |= uint64_t (1) << (seq - base);
+    m.nacked = now;
+    count++;
   }
 
-  // Check out-of-order queue if next packet exists 
-  if (!m_outOfOrderQueue->IsEmpty()) {
+  if (bitmap != 0) {
+    ReliableUdpHeader nackHeader;
+    nackHeader.SetNack (base, bitmap);
+    SendFeedback (s, nackHeader);
+    s.lastNackTime = now;
+    m_nacksSent++;
+    if (m_recorder != 0) {
+      m_recorder->Record (ReliableUdpEventRecorder::TX_NACK, s.id, base, count);
+    }
+  }
+  if (more) {
+    ScheduleNack (s, now);
+  } else if (!nextRetry.IsNegative ()) {
+    ScheduleNack (s, nextRetry);
+  }
+}
+
+void
+ReliableUdpClient::RearrangePackets (uint16_t streamId)
+{
+  Stream &s = GetStream (streamId);
+  Simulator::Cancel (s.skipGapEvent);
+  while (true) {
+    // Deliver the whole contiguous run following the last in-order packet 
+    Ptr<Packet> p;
+    while ((p = s.reorderBuffer.PopInOrder ())) {
+      ReliableUdpHeader header;
+      uint32_t payloadSize = p->GetSize () - p->PeekHeader (header);
+      m_bytesDelivered += payloadSize;
+      ReassembleFrame (s, header, payloadSize);
+    }
+    // The server abandoned everything below the forward seq # 
+    if (int32_t (s.reorderBuffer.GetNextExpected () - s.forwardSeq) < 0) {
+      NS_LOG_INFO ("Skip seq " << s.reorderBuffer.GetNextExpected () << " abandoned by server");
+      s.reorderBuffer.SkipNext ();
+      continue;
+    }
+
+    uint32_t seq;
+    p = s.reorderBuffer.PeekFirst (&seq);
+    if (p == 0) {
+      break;
+    }
+    // Packets in the gap have earlier deadlines than the one after it 
     ReliableUdpHeader header;
-    Ptr<Packet> p = m_outOfOrderQueue->Peek()->Copy();
-    p->RemoveHeader (header);
-    // In-order; schedule and return 
-    if (header.GetSeqNum() == m_lastArrangedSeq + 1) {
-      m_outOfOrderQueue->Dequeue();
-      m_inOrderQueue->Enqueue(p);
-      m_lastArrangedSeq++;
-
-      m_rearrangePacketsEvent = Simulator::Schedule(
-        MilliSeconds(10), 
-        &ReliableUdpClient::RearrangePackets, this
+    p->PeekHeader (header);
+    Time deadline = header.GetDeadline ();
+    if (deadline.IsZero ()) {
+      break;
+    }
+    if (deadline > Simulator::Now ()) {
+      s.skipGapEvent = Simulator::Schedule (
+        deadline - Simulator::Now (),
+        &ReliableUdpClient::RearrangePackets, this, streamId
       );
-      return;
-    } 
+      break;
+    }
+    NS_LOG_INFO ("Skip expired gap [" << s.reorderBuffer.GetNextExpected () << ", " << seq << ")");
+    while (s.reorderBuffer.GetNextExpected () != seq) {
+      s.reorderBuffer.SkipNext ();
+    }
+  }
+  UpdateOccupancy ();
+}
+
+void
+ReliableUdpClient::ReassembleFrame (Stream &s, ReliableUdpHeader &header, uint32_t payloadSize)
+{
+  if (s.fragmentsReceived > 0 && header.GetFrameId () != s.assembly.id) {
+    NS_LOG_INFO ("Frame " << s.assembly.id << " is incomplete, dropping it");
+    s.fragmentsReceived = 0;
+  }
+  if (s.fragmentsReceived == 0) {
+    s.assembly.id = header.GetFrameId ();
+    s.assembly.type = header.GetFrameType ();
+    s.assembly.size = 0;
+    s.assembly.deadline = header.GetDeadline ();
   }
+  s.assembly.size += payloadSize;
+  s.fragmentsReceived++;
 
-  // Next packet is not at the front of out-of-order queue
-  // Check retransmit queue if next packet exists 
-  if (!m_retransQueue.empty()) {
-    Ptr<Packet> firstRetransmitPacket = m_retransQueue.top()->Copy();
-    ReliableUdpHeader rHeader;
-    firstRetransmitPacket->RemoveHeader(rHeader);
-    if (rHeader.GetSeqNum() == m_lastArrangedSeq + 1) {
-      m_retransQueue.pop();
-      m_inOrderQueue->Enqueue(firstRetransmitPacket);
-      m_lastArrangedSeq++;
+  if (header.GetFragIndex () + 1 == header.GetFragCount ()) {
+    if (s.fragmentsReceived == header.GetFragCount ()) {
+      s.assembly.completed = Simulator::Now ();
+      s.inOrderQueue.push_back (s.assembly);
+      s.packetsPerFrame = 0.875 * s.packetsPerFrame + 0.125 * header.GetFragCount ();
+      UpdateJitter (s, s.assembly);
+      if (!s.playing && GetBufferedTime (s) >= s.targetDepth) {
+        StartPlayback (s);
+      }
+    } else {
+      NS_LOG_INFO ("Frame " << s.assembly.id << " is incomplete, dropping it");
     }
+    s.fragmentsReceived = 0;
   }
+}
 
-  // Repeat
-  m_rearrangePacketsEvent = Simulator::Schedule (
-    MilliSeconds(200), 
-    &ReliableUdpClient::RearrangePackets, this
-  );
+void
+ReliableUdpClient::UpdateJitter (Stream &s, const ReceivedFrame &frame)
+{
+  if (frame.deadline.IsZero ()) {
+    return;
+  }
+  // Deadlines are frame timestamps shifted by the playout delay, so the 
+  // change of completion time minus deadline is the RFC 3550 transit 
+  // difference 
+  Time transit = frame.completed - frame.deadline;
+  if (!s.lastTransit.IsZero ()) {
+    double d = std::fabs ((transit - s.lastTransit).GetSeconds ());
+    s.jitter = Seconds (s.jitter.GetSeconds () + (d - s.jitter.GetSeconds ()) / 16);
+  }
+  s.lastTransit = transit;
+
+  Time target = std::max (m_prebuffer, Seconds (m_jitterFactor * s.jitter.GetSeconds ()));
+  target = std::min (target, m_maxBufferDepth);
+  if (target != s.targetDepth) {
+    s.targetDepth = target;
+    m_targetDepth = target;
+  }
+}
+
+Time
+ReliableUdpClient::GetBufferedTime (const Stream &s) const
+{
+  return Seconds (s.inOrderQueue.size () / m_frameRate);
+}
+
+void
+ReliableUdpClient::StartPlayback (Stream &s)
+{
+  if (!s.started) {
+    s.started = true;
+    NS_LOG_INFO ("Playback of stream " << s.id << " starts after " << (Simulator::Now () - m_firstPacketTime).GetSeconds () << "s");
+    m_startupTrace (Simulator::Now () - m_firstPacketTime);
+  } else {
+    NS_LOG_INFO ("Playback of stream " << s.id << " resumes after a stall of "
+                 << (Simulator::Now () - s.stallStart).GetSeconds () << "s");
+    m_stallTrace (Simulator::Now () - s.stallStart);
+  }
+  s.playing = true;
+  PlayFrame (s.id);
 }
 
 void
-ReliableUdpClient::ConsumePackets (void) 
+ReliableUdpClient::PlayFrame (uint16_t streamId) 
 {
-  // Dequeue packets from in-order queue 
-  uint32_t nPackets = m_inOrderQueue->GetNPackets();
-  if (nPackets >= 200) 
-    for (int i = 0; i < 200; i++) {
-      m_inOrderQueue->Dequeue();
+  Stream &s = GetStream (streamId);
+  if (s.inOrderQueue.empty ()) {
+    // Buffer underrun: stall until the target depth is buffered again 
+    NS_LOG_INFO ("Playout buffer of stream " << s.id << " ran dry, rebuffering");
+    s.playing = false;
+    s.stallStart = Simulator::Now ();
+    m_rebuffers++;
+    if (m_recorder != 0) {
+      m_recorder->Record (ReliableUdpEventRecorder::STALL, s.id, 0, 0);
     }
-  m_consumePacketsEvent = Simulator::Schedule (
-    MilliSeconds(33),
-    &ReliableUdpClient::ConsumePackets, this
+    return;
+  }
+  const ReceivedFrame &frame = s.inOrderQueue.front ();
+  bool late = !frame.deadline.IsZero () && Simulator::Now () > frame.deadline;
+  if (late) {
+    m_lateFrames++;
+  }
+  if (m_recorder != 0) {
+    m_recorder->Record (ReliableUdpEventRecorder::FRAME_PLAYED, s.id, frame.id, frame.size,
+                        late ? ReliableUdpEventRecorder::LATE : 0);
+  }
+  s.inOrderQueue.pop_front ();
+  UpdateOccupancy ();
+
+  // A window that was closing has opened again; do not wait for data, 
+  // which may be stopped by it, to announce it 
+  uint32_t expected = s.reorderBuffer.GetNextExpected ();
+  if (int32_t (s.advertisedEdge - expected) < int32_t (GetWindowEdge (s) - expected) / 2) {
+    SendAck (s.id);
+  }
+  s.playEvent = Simulator::Schedule (
+    Seconds (1 / m_frameRate),
+    &ReliableUdpClient::PlayFrame, this, streamId
   );
 }
 
 void
-ReliableUdpClient::SendAck (uint32_t ackNum, uint8_t signal)
+ReliableUdpClient::UpdateAckState (Stream &s, bool immediate)
+{
+  if (immediate || ++s.pendingAcks >= m_ackEveryN) {
+    SendAck (s.id);
+  } else if (!s.delayedAckEvent.IsRunning ()) {
+    s.delayedAckEvent = Simulator::Schedule (
+      m_ackDelay,
+      &ReliableUdpClient::SendAck, this, s.id
+    );
+  }
+}
+
+void
+ReliableUdpClient::SendAck (uint16_t streamId)
 {
   ReliableUdpHeader ackHeader;
-  ackHeader.SetAckNum (ackNum);
-  ackHeader.SetSignal (signal);
-  Ptr<Packet> headerOnlyPacket = Create<Packet> (ackHeader.GetSerializedSize());
+  SendFeedback (GetStream (streamId), ackHeader);
+}
+
+void
+ReliableUdpClient::SendFeedback (Stream &s, ReliableUdpHeader &ackHeader)
+{
+  s.pendingAcks = 0;
+  Simulator::Cancel (s.delayedAckEvent);
+
+  ackHeader.SetStreamId (s.id);
+  ackHeader.SetAckNum (s.reorderBuffer.GetNextExpected ());
+  ackHeader.SetSackBitmap (s.reorderBuffer.GetSackBitmap ());
+  s.advertisedEdge = GetWindowEdge (s);
+  ackHeader.SetWindowEdge (s.advertisedEdge);
+  ackHeader.SetBufferLevel (GetBufferedTime (s));
+  uint32_t echo = s.timestampRecent;
+  if (echo != 0) {
+    echo += uint32_t ((Simulator::Now () - s.timestampArrival).GetMicroSeconds ());
+    echo = echo == 0 ? 1 : echo;
+  }
+  ackHeader.SetTimestampEcho (echo);
+  s.timestampRecent = 0;
+  Ptr<Packet> headerOnlyPacket = Create<Packet> (0);
   headerOnlyPacket->AddHeader (ackHeader);
   m_socket->Send (headerOnlyPacket);
+  m_acksSent++;
+  if (m_recorder != 0 && ackHeader.GetNackBitmap () == 0) {
+    m_recorder->Record (ReliableUdpEventRecorder::TX_ACK, s.id, ackHeader.GetAckNum (), s.advertisedEdge);
+  }
+}
+
+void
+ReliableUdpClient::ScheduleFeedback (Stream &s)
+{
+  if (!s.delayedAckEvent.IsRunning ()) {
+    s.delayedAckEvent = Simulator::Schedule (m_feedbackInterval, &ReliableUdpClient::SendAck, this, s.id);
+  }
+}
+
+void
+ReliableUdpClient::CheckSession (void)
+{
+  Time silence = Simulator::Now () - m_lastPacketTime;
+  if (silence >= m_silenceTimeout) {
+    // Answered by a hello if the server dropped the session; while 
+    // reconnecting, the hellos do that 
+    if (!m_firstPacketTime.IsNegative ()) {
+      NS_LOG_INFO ("No packet for " << silence.GetSeconds () << "s, checking the session");
+      SendAck (0);
+    }
+    silence = Seconds (0);
+  }
+  m_silenceEvent = Simulator::Schedule (m_silenceTimeout - silence, &ReliableUdpClient::CheckSession, this);
+}
+
+void
+ReliableUdpClient::CancelStreams (void)
+{
+  for (std::map<uint16_t, Stream>::iterator it = m_streams.begin (); it != m_streams.end (); ++it) {
+    Simulator::Cancel (it->second.playEvent);
+    Simulator::Cancel (it->second.delayedAckEvent);
+    Simulator::Cancel (it->second.skipGapEvent);
+    Simulator::Cancel (it->second.nackEvent);
+  }
+}
+
+void
+ReliableUdpClient::SendHello (void)
+{
+  ReliableUdpHeader helloHeader;
+  helloHeader.SetFlags (ReliableUdpHeader::FLAG_HELLO);
+  // The hello stands for stream 0, the one every session carries 
+  Stream &s = GetStream (0);
+  s.advertisedEdge = GetWindowEdge (s);
+  helloHeader.SetWindowEdge (s.advertisedEdge);
+  Ptr<Packet> headerOnlyPacket = Create<Packet> (0);
+  headerOnlyPacket->AddHeader (helloHeader);
+  m_socket->Send (headerOnlyPacket);
+
+  m_helloEvent = Simulator::Schedule (
+    m_helloInterval,
+    &ReliableUdpClient::SendHello, this
+  );
 }
 
+uint32_t
+ReliableUdpClient::GetWindowEdge (const Stream &s) const
+{
+  // The reorder window takes [next expected, next expected + capacity) 
+  uint32_t credit = s.reorderBuffer.GetCapacity ();
+  double freeFrames = m_playoutCapacity.GetSeconds () * m_frameRate - s.inOrderQueue.size ();
+  if (freeFrames <= 0) {
+    credit = 0;
+  } else {
+    credit = std::min (credit, uint32_t (freeFrames * s.packetsPerFrame));
+  }
+  return s.reorderBuffer.GetNextExpected () + credit;
 }
 
+void
+ReliableUdpClient::UpdateOccupancy (void)
+{
+  uint32_t packets = 0;
+  uint32_t frames = 0;
+  for (std::map<uint16_t, Stream>::const_iterator it = m_streams.begin (); it != m_streams.end (); ++it) {
+    packets += it->second.reorderBuffer.GetNPackets ();
+    frames += it->second.inOrderQueue.size ();
+  }
+  m_reorderBufferPackets = packets;
+  m_inOrderFrames = frames;
+}
+
+}
@@ -7,25 +7,22 @@
 #include "ns3/address.h"
 #include "ns3/traced-callback.h"
 #include "ns3/queue.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
 #include "reliable-udp-header.h"
-#include <queue> // For stl priority queue 
-
-#define MAX_QUEUE_SIZE 9999 //!< temporary value
+#include "reliable-udp-reorder-buffer.h"
+#include "reliable-udp-fec.h"
+#include "reliable-udp-event-recorder.h"
+#include <deque>
+#include <map>
+#include <vector>
 
 namespace ns3 {
 
 class Socket;
 class Packet;
 
-struct cmp {
-  bool operator()(Ptr<Packet> a, Ptr<Packet> b) {
-    ReliableUdpHeader appHeaderA, appHeaderB;
-    a->RemoveHeader(appHeaderA);
-    b->RemoveHeader(appHeaderB);
-    return appHeaderA.GetSeqNum() < appHeaderB.GetSeqNum();
-  }
-};
-
 /**
  * \ingroup applications
  * \defgroup reliableudpclient ReliableUdpClient
@@ -34,9 +31,22 @@ struct cmp {
 /**
  * \ingroup reliableudpclient
  * \brief A UDP client, receives UDP packets from a remote server in a reliable way. 
- * UDP packets are divided from frames and enqueued to particular queue when 
- * they are not a retransmitted one. The retransmitted packets are enqueued  
- * to the other particular queue for reliability. 
+ * UDP packets are divided from frames. Both regular and retransmitted packets 
+ * are stored in a fixed-capacity reorder window indexed by sequence #, and 
+ * every contiguous run is reassembled into frames as soon as a gap fills.
+ * Whole frames are kept in the in-order queue, which acts as the playout 
+ * buffer: it is drained at the frame rate once it holds the target depth, 
+ * and playback stalls and rebuffers when it runs dry.
+ * Packets lost from a FEC block are rebuilt from its parity packets when 
+ * enough of them arrive, without waiting for a retransmission.
+ * Each stream multiplexed by the server gets its own reorder window, FEC 
+ * decoder, playout buffer and acks, so a gap in one stream does not hold 
+ * back the others. A stream is set up by its first packet.
+ * With ReliabilityMode Nack, an ack goes out FeedbackInterval after the 
+ * first packet it acks, and none while nothing arrives. The missing 
+ * packets are NACKed as soon as a gap or a keepalive of the 
+ * server reveals them, at most one NACK per NackInterval. A packet still 
+ * missing is NACKed again once its resend is overdue.
  */
 class ReliableUdpClient : public Application
 {
@@ -68,9 +78,70 @@ protected:
   virtual void DoDispose (void);
 
 private:
+  /// A frame reassembled from in-order packets
+  struct ReceivedFrame
+  {
+    uint32_t id;        //!< Frame # 
+    uint8_t type;       //!< I/P/B 
+    uint32_t size;      //!< Payload bytes of all fragments 
+    Time completed;     //!< Time its last fragment was delivered in order 
+    Time deadline;      //!< Presentation deadline set by the server 
+  };
+
+  /// A packet found missing, at slot (seq % ReorderWindow)
+  struct MissingPacket
+  {
+    Time detected;      //!< Time the gap or keepalive revealed it 
+    Time nacked;        //!< Time it was last NACKed; zero if never 
+  };
+
+  /// Receive state of one stream
+  struct Stream
+  {
+    Stream ();
+
+    uint16_t id; //!< Stream # 
+    ReliableUdpReorderBuffer reorderBuffer; //!< out-of-order packets window
+    uint32_t forwardSeq; //!< Server will not resend packets below it
+    EventId skipGapEvent; //!< Event to skip a gap when its deadline passes
+    ReliableUdpFecDecoder fecDecoder; //!< Rebuilds packets from FEC parity
+
+    ReceivedFrame assembly; //!< Frame being reassembled
+    uint16_t fragmentsReceived; //!< Fragments of assembly received so far
+    std::deque<ReceivedFrame> inOrderQueue; //!< in-order queue of whole frames
+    uint32_t pendingAcks; //!< Packets received since the last ack
+    EventId delayedAckEvent; //!< Event to send the pending ack
+
+    Time jitter; //!< Interarrival jitter of frames, as in RFC 3550
+    Time lastTransit; //!< Completion time minus deadline of the last frame
+    Time targetDepth; //!< Buffered play time needed to (re)start playback
+    bool playing; //!< Whether frames are being played
+    bool started; //!< Whether playback has started once
+    Time stallStart; //!< Time the current stall began
+    EventId playEvent; //!< Event to play the next frame
+
+    double packetsPerFrame; //!< Average fragments per frame
+    uint32_t advertisedEdge; //!< Window edge of the last ack
+    uint32_t timestampRecent; //!< Timestamp the next ack echoes; zero for none
+    Time timestampArrival; //!< Time the packet of timestampRecent arrived
+
+    uint32_t receivedEdge; //!< Seq # following the highest one known to be sent
+    std::vector<MissingPacket> missing; //!< Missing packets of the window by seq # 
+    Time lastNackTime;  //!< Time the last NACK was sent
+    EventId nackEvent;  //!< Event to send the next NACK
+    Time nackRtt;       //!< Smoothed time from a NACK to the resent packet; zero before a sample
+  };
+
   virtual void StartApplication (void);
   virtual void StopApplication (void);
 
+  /**
+   * \brief Get the state of a stream, setting it up on first use.
+   * \param streamId the stream
+   * \return the stream
+   */
+  Stream &GetStream (uint16_t streamId);
+
   /**
    * \brief Handle a packet reception.
    
@@ -79,40 +150,214 @@ private:
    * \param socket the socket which is a packet was received to.
    */
   void HandleRead (Ptr<Socket> socket);
+
+  /**
+   * \brief Store a received or rebuilt data packet in the reorder window of its stream.
+   * \param s the stream
+   * \param packet the packet, including its header
+   * \param immediate set when the packet warrants an immediate ack
+   * \return false if the packet did not fit in the window
+   */
+  bool InsertPacket (Stream &s, Ptr<Packet> packet, bool &immediate);
  
   /**
-   * \brief Store one or more in-order packets.
+   * \brief Take note that the packets from receivedEdge up to seq were not received.
+   * Only the reorder window is tracked. In NACK_MODE they are NACKed.
+   * \param s the stream
+   * \param seq sequence # following the packets found missing
+   */
+  void MarkMissing (Stream &s, uint32_t seq);
+
+  /**
+   * \brief Make sure SendNack() runs at a given time, or later to keep NACKs m_nackInterval apart.
+   * \param s the stream
+   * \param at time to send the NACK at
+   */
+  void ScheduleNack (Stream &s, Time at);
+
+  /**
+   * \brief NACK the missing packets of a stream that were never NACKed or whose resend is overdue.
+   * One NACK asks for up to 64 packets from the first one; the rest go in 
+   * the next. A resend is overdue twice the NACK round trip after the 
+   * NACK, or m_nackRetryTimeout before the first sample. Packets below the 
+   * forward seq # are not asked for.
+   * \param streamId the stream
+   */
+  void SendNack (uint16_t streamId);
+
+  /**
+   * \brief Move every in-order packet from the reorder window to the frame assembler.
  
-   * This function is called periodically.
+   * Gaps below the forward seq # announced by the server are skipped, and so 
+   * is a gap followed by a packet whose deadline has passed, as the missing 
+   * packets are too late to be played anyway. Otherwise it is rescheduled 
+   * for the deadline of the packet following the gap.
+   * This function is called whenever a packet is stored in the reorder window.
+   * \param streamId the stream
+   */
+  void RearrangePackets (uint16_t streamId);
+
+  /**
+   * \brief Add an in-order packet to the frame being reassembled.
+
+   * When the last fragment of the frame arrives, the frame is moved to the 
+   * in-order queue. A frame whose fragments are not all present is dropped.
+   * \param s the stream
+   * \param header header of the packet
+   * \param payloadSize size of the packet without its header
+   */
+  void ReassembleFrame (Stream &s, ReliableUdpHeader &header, uint32_t payloadSize);
+
+  /**
+   * \brief Update the jitter estimate and the target depth with a completed frame.
+   * \param s the stream
+   * \param frame the frame just moved to the in-order queue
+   */
+  void UpdateJitter (Stream &s, const ReceivedFrame &frame);
+
+  /**
+   * \param s the stream
+   * \return the play time of the frames in the in-order queue
+   */
+  Time GetBufferedTime (const Stream &s) const;
+
+  /**
+   * \brief Start or resume playback once the target depth is buffered.
+   * \param s the stream
+   */
+  void StartPlayback (Stream &s);
+
+  /**
+   * \brief Play the frame at the head of the in-order queue.
+
+   * This function is called every frame interval while playing. Playback 
+   * stalls when there is no frame to play.
+   * \param streamId the stream
+   */
+  void PlayFrame (uint16_t streamId);
+
+  /**
+   * \brief Acknowledge a received packet.
+
+   * Acks are coalesced: one is sent every m_ackEveryN packets or when the 
+   * delayed-ack timer expires, unless immediate is set.
+   * \param s the stream
+   * \param immediate true when a gap, a gap fill or a duplicate was seen
+   */
+  void UpdateAckState (Stream &s, bool immediate);
+
+  /**
+   * \brief Send a cumulative ack with a SACK bitmap of the packets beyond it.
+   * \param streamId the stream acked
+   */
+  void SendAck (uint16_t streamId);
+
+  /**
+   * \brief Fill in the ack fields of a header and send it to the server.
+
+   * Every ack advertises the receive window from GetWindowEdge() and 
+   * echoes the timestamp of the latest original transmission, once. The 
+   * echo is advanced by the time the client held it, which delayed or 
+   * periodic acks would otherwise add to the RTT.
+   * \param s the stream acked
+   * \param header the header, possibly carrying a NACK
+   */
+  void SendFeedback (Stream &s, ReliableUdpHeader &header);
+
+  /**
+   * \brief In NACK_MODE, make sure an ack goes out within m_feedbackInterval.
+   * \param s the stream to ack
+   */
+  void ScheduleFeedback (Stream &s);
+
+  /**
+   * \brief Ask the server to open a session for this client.
+
+   * It is repeated every m_helloInterval until the first packet arrives.
    */
-  void RearrangePackets (void);
+  void SendHello (void);
 
   /**
-   * \brief Consume packets from queue which has in-order packets.
+   * \brief Ack stream 0 if nothing arrived for m_silenceTimeout, and check again later.
 
-   * This function is called periodically.
+   * A server that timed out the session answers with a hello, upon which 
+   * the streams start over and the client says hello again.
    */
-  void ConsumePackets (void);
+  void CheckSession (void);
 
   /**
-   * \brief Request server to stop sending packets.
+   * \brief Cancel the events of every stream.
+   */
+  void CancelStreams (void);
+
+  /**
+   * \brief Compute the advertised receive window of a stream.
 
-   * This function is called when the queue which has out-of-order packets is full.
+   * The window is the smaller of the free reorder window and the free 
+   * playout buffer, converted to packets with the average fragments per frame.
+   * \param s the stream
+   * \return the sequence # the server may send up to, exclusive
    */
-  void SendAck (uint32_t ackNum, uint8_t signal);
+  uint32_t GetWindowEdge (const Stream &s) const;
+
+  /**
+   * \brief Update the ReorderBuffer and InOrderQueue gauges from the streams.
+   */
+  void UpdateOccupancy (void);
 
-  bool m_receiving;
   Ptr<Socket> m_socket; //!< Socket
   Address m_peerAddress; //!< Remote peer address
   uint16_t m_peerPort; //!< Remote peer port
-  uint32_t m_lastArrangedSeq;
-
-  Ptr<Queue<Packet>> m_outOfOrderQueue; //!< out-of-order packets queue
-  Ptr<Queue<Packet>> m_inOrderQueue; //!< in-order queue
-  //!< retrasmitted packets queue
-  std::priority_queue<Ptr<Packet>, std::vector<Ptr<Packet> >, cmp> m_retransQueue; 
-  EventId m_rearrangePacketsEvent; //!< Event to rearrange packets from out-of-order queue
-  EventId m_consumePacketsEvent; //!< Event to consume packets from in-order queue   
+
+  std::map<uint16_t, Stream> m_streams; //!< Streams by id
+  uint32_t m_reorderWindow; //!< capacity of a reorder window in packets
+
+  uint32_t m_fecHistory; //!< Recent data packets kept for decoding
+  uint32_t m_fecSymbolSize; //!< Max size of a FEC symbol in bytes
+  TracedValue<uint32_t> m_fecRecovered; //!< Packets rebuilt by FEC
+  TracedValue<uint32_t> m_fecUnrecovered; //!< Packets of FEC blocks that could not be rebuilt
+
+  uint32_t m_ackEveryN; //!< Number of packets acked by one ack
+  Time m_ackDelay; //!< Max time an ack is delayed for coalescing
+
+  ReliableUdpHeader::ReliabilityMode m_reliabilityMode; //!< How losses are reported
+  Time m_feedbackInterval; //!< Time an ack waits for more packets in NACK_MODE
+  Time m_nackInterval; //!< Min time between NACKs of a stream
+  Time m_nackRetryTimeout; //!< Time before a missing packet is NACKed again, until the NACK round trip is measured
+  TracedValue<uint32_t> m_acksSent; //!< Acks sent, NACKs included
+  TracedValue<uint32_t> m_nacksSent; //!< NACKs sent
+  TracedCallback<Time> m_recoveryTrace; //!< Fired with the time from finding a packet missing to its arrival
+
+  double m_frameRate; //!< Frames played per second
+  Time m_prebuffer; //!< Min buffered play time before playback starts or resumes
+  Time m_maxBufferDepth; //!< Max target depth of the playout buffer
+  double m_jitterFactor; //!< Target depth in multiples of the jitter
+  Time m_firstPacketTime; //!< Time the first packet of the session arrived; negative before
+  Time m_lastPacketTime; //!< Time the latest packet arrived
+  Time m_silenceTimeout; //!< Time without packets before the session is checked
+  EventId m_silenceEvent; //!< Event to check the session
+  TracedValue<Time> m_targetDepth; //!< Target depth of the stream updated last
+  TracedValue<uint32_t> m_rebuffers; //!< Number of stalls after startup
+  TracedValue<uint32_t> m_lateFrames; //!< Frames played after their deadline
+  TracedCallback<Time> m_stallTrace; //!< Fired with the duration of each stall
+  TracedCallback<Time> m_startupTrace; //!< Fired with the startup delay
+  TracedCallback<Time> m_delayTrace; //!< Fired with the one-way delay of each data packet
+
+  TracedValue<uint32_t> m_packetsReceived; //!< Data packets received, duplicates included
+  TracedValue<uint32_t> m_duplicates; //!< Data packets received more than once
+  TracedValue<uint32_t> m_reordered; //!< Data packets received ahead of a missing one
+  TracedValue<uint32_t> m_packetsDropped; //!< Packets dropped out of the reorder window or of another version
+  TracedValue<uint64_t> m_bytesDelivered; //!< Payload bytes delivered in order
+  TracedValue<uint32_t> m_reorderBufferPackets; //!< Packets in the reorder windows of all streams
+  TracedValue<uint32_t> m_inOrderFrames; //!< Frames in the in-order queues of all streams
+
+  Time m_playoutCapacity; //!< Max play time held by the playout buffer
+  Time m_helloInterval; //!< Time between hellos until the server answers
+  EventId m_helloEvent; //!< Event to resend the hello
+
+  std::string m_eventTrace; //!< File to record events to; empty records none
+  uint32_t m_eventBufferSize; //!< Events buffered before they are written out
+  Ptr<ReliableUdpEventRecorder> m_recorder; //!< Records events; 0 for none
 };
 
 } // namespace ns3
@@ -0,0 +1,391 @@
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "reliable-udp-congestion-control.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpCongestionControl");
+
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpCongestionControl);
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpAimd);
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpDelayGradient);
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpBbr);
+
+TypeId
+ReliableUdpCongestionControl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpCongestionControl")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    ;
+  return tid;
+}
+
+ReliableUdpCongestionControl::~ReliableUdpCongestionControl ()
+{
+}
+
+DataRate
+ReliableUdpCongestionControl::GetPacingRate (void) const
+{
+  return DataRate (0);
+}
+
+/* ReliableUdpAimd */
+
+TypeId
+ReliableUdpAimd::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpAimd")
+    .SetParent<ReliableUdpCongestionControl> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpAimd> ()
+    .AddAttribute ("InitialWindow", "Initial congestion window in packets",
+                   DoubleValue (10),
+                   MakeDoubleAccessor (&ReliableUdpAimd::m_cwnd),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("InitialSlowStartThreshold", "Initial slow start threshold in packets",
+                   DoubleValue (1e6),
+                   MakeDoubleAccessor (&ReliableUdpAimd::m_ssthresh),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("AdditiveIncrease", "Packets added to the window per RTT",
+                   DoubleValue (1),
+                   MakeDoubleAccessor (&ReliableUdpAimd::m_increase),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("MultiplicativeDecrease", "Factor applied to the window on loss",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&ReliableUdpAimd::m_decrease),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("MinWindow", "Lower bound of the congestion window in packets",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&ReliableUdpAimd::m_minWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    ;
+  return tid;
+}
+
+ReliableUdpAimd::ReliableUdpAimd ()
+  : m_cwnd (10),
+    m_ssthresh (1e6),
+    m_increase (1),
+    m_decrease (0.5),
+    m_minWindow (2)
+{
+}
+
+void
+ReliableUdpAimd::OnAck (uint32_t packets, uint32_t bytes, uint32_t inFlight, Time rtt)
+{
+  if (m_cwnd < m_ssthresh) {
+    m_cwnd += packets;
+  } else {
+    // One window's worth of acks adds m_increase packets 
+    m_cwnd += m_increase * packets / m_cwnd;
+  }
+}
+
+void
+ReliableUdpAimd::OnLoss (uint32_t inFlight)
+{
+  m_ssthresh = std::max (m_cwnd * m_decrease, double (m_minWindow));
+  m_cwnd = m_ssthresh;
+  NS_LOG_DEBUG ("Loss; cwnd " << m_cwnd);
+}
+
+void
+ReliableUdpAimd::OnTimeout (void)
+{
+  m_ssthresh = std::max (m_cwnd * m_decrease, double (m_minWindow));
+  m_cwnd = m_minWindow;
+  NS_LOG_DEBUG ("Timeout; ssthresh " << m_ssthresh);
+}
+
+uint32_t
+ReliableUdpAimd::GetCongestionWindow (void) const
+{
+  return std::max (uint32_t (m_cwnd), m_minWindow);
+}
+
+/* ReliableUdpDelayGradient */
+
+TypeId
+ReliableUdpDelayGradient::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpDelayGradient")
+    .SetParent<ReliableUdpCongestionControl> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpDelayGradient> ()
+    .AddAttribute ("InitialWindow", "Initial congestion window in packets",
+                   DoubleValue (10),
+                   MakeDoubleAccessor (&ReliableUdpDelayGradient::m_cwnd),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("AdditiveIncrease", "Packets added to the window per RTT when delay is not rising",
+                   DoubleValue (1),
+                   MakeDoubleAccessor (&ReliableUdpDelayGradient::m_increase),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("Beta", "Sensitivity of the decrease to the normalized RTT gradient",
+                   DoubleValue (0.8),
+                   MakeDoubleAccessor (&ReliableUdpDelayGradient::m_beta),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("LowThreshold", "Queueing delay under which the window always grows",
+                   TimeValue (MilliSeconds (2)),
+                   MakeTimeAccessor (&ReliableUdpDelayGradient::m_lowThreshold),
+                   MakeTimeChecker ())
+    .AddAttribute ("HighThreshold", "Queueing delay over which the window always shrinks",
+                   TimeValue (MilliSeconds (50)),
+                   MakeTimeAccessor (&ReliableUdpDelayGradient::m_highThreshold),
+                   MakeTimeChecker ())
+    .AddAttribute ("MinWindow", "Lower bound of the congestion window in packets",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&ReliableUdpDelayGradient::m_minWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    ;
+  return tid;
+}
+
+ReliableUdpDelayGradient::ReliableUdpDelayGradient ()
+  : m_cwnd (10),
+    m_increase (1),
+    m_beta (0.8),
+    m_minWindow (2)
+{
+}
+
+void
+ReliableUdpDelayGradient::OnAck (uint32_t packets, uint32_t bytes, uint32_t inFlight, Time rtt)
+{
+  if (rtt.IsZero ()) {
+    return;
+  }
+  Time now = Simulator::Now ();
+  if (m_srtt.IsZero ()) {
+    m_srtt = m_minRtt = m_prevRtt = rtt;
+    m_roundStart = now;
+    return;
+  }
+  m_srtt = Seconds (0.875 * m_srtt.GetSeconds () + 0.125 * rtt.GetSeconds ());
+  m_minRtt = std::min (m_minRtt, rtt);
+  if (now - m_roundStart < m_srtt) {
+    return;
+  }
+
+  // One decision per round 
+  double srtt = m_srtt.GetSeconds ();
+  Time queueing = m_srtt - m_minRtt;
+  if (queueing < m_lowThreshold) {
+    m_cwnd += m_increase;
+  } else if (queueing > m_highThreshold) {
+    double high = (m_minRtt + m_highThreshold).GetSeconds ();
+    m_cwnd *= 1 - m_beta * (1 - high / srtt);
+  } else {
+    double gradient = (srtt - m_prevRtt.GetSeconds ()) / m_minRtt.GetSeconds ();
+    if (gradient <= 0) {
+      m_cwnd += m_increase;
+    } else {
+      m_cwnd *= std::max (0.5, 1 - m_beta * gradient);
+    }
+  }
+  m_cwnd = std::max (m_cwnd, double (m_minWindow));
+  NS_LOG_DEBUG ("srtt " << m_srtt << " min " << m_minRtt << " cwnd " << m_cwnd);
+  m_prevRtt = m_srtt;
+  m_roundStart = now;
+}
+
+void
+ReliableUdpDelayGradient::OnLoss (uint32_t inFlight)
+{
+  m_cwnd = std::max (m_cwnd * 0.5, double (m_minWindow));
+}
+
+void
+ReliableUdpDelayGradient::OnTimeout (void)
+{
+  m_cwnd = m_minWindow;
+}
+
+uint32_t
+ReliableUdpDelayGradient::GetCongestionWindow (void) const
+{
+  return std::max (uint32_t (m_cwnd), m_minWindow);
+}
+
+/* ReliableUdpBbr */
+
+namespace {
+const double g_startupGain = 2.89;  //!< 2/ln(2), doubles the rate every round 
+const double g_probeBwGains[] = { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+const uint32_t g_probeBwCycle = sizeof (g_probeBwGains) / sizeof (g_probeBwGains[0]);
+const uint32_t g_minPipeWindow = 4;
+} // anonymous namespace
+
+TypeId
+ReliableUdpBbr::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpBbr")
+    .SetParent<ReliableUdpCongestionControl> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpBbr> ()
+    .AddAttribute ("InitialWindow", "Congestion window in packets before the first bandwidth sample",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&ReliableUdpBbr::m_initialWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BandwidthWindow", "Number of rounds kept by the max bandwidth filter",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&ReliableUdpBbr::m_bwWindowRounds),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MinRttWindow", "Lifetime of a min RTT sample before PROBE_RTT",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&ReliableUdpBbr::m_minRttWindow),
+                   MakeTimeChecker ())
+    ;
+  return tid;
+}
+
+ReliableUdpBbr::ReliableUdpBbr ()
+  : m_mode (STARTUP),
+    m_pacingGain (g_startupGain),
+    m_cwndGain (g_startupGain),
+    m_initialWindow (10),
+    m_bwWindowRounds (10),
+    m_btlBw (0),
+    m_meanPacketSize (0),
+    m_roundStart (Seconds (-1)),
+    m_roundDelivered (0),
+    m_fullBw (0),
+    m_fullBwRounds (0),
+    m_cycleIndex (0)
+{
+}
+
+void
+ReliableUdpBbr::OnAck (uint32_t packets, uint32_t bytes, uint32_t inFlight, Time rtt)
+{
+  Time now = Simulator::Now ();
+  if (packets > 0) {
+    double size = double (bytes) / packets;
+    m_meanPacketSize = m_meanPacketSize == 0 ? size : 0.9 * m_meanPacketSize + 0.1 * size;
+  }
+  if (!rtt.IsZero () && (m_minRtt.IsZero () || rtt <= m_minRtt
+                         || (m_mode != PROBE_RTT && now - m_minRttStamp > m_minRttWindow))) {
+    m_minRtt = rtt;
+    m_minRttStamp = now;
+  }
+  if (m_roundStart.IsNegative ()) {
+    m_roundStart = now;
+    return;
+  }
+
+  m_roundDelivered += bytes;
+  if (!m_minRtt.IsZero () && now - m_roundStart >= m_minRtt) {
+    EndRound (inFlight);
+  }
+
+  if (m_mode == PROBE_RTT) {
+    if (now >= m_probeRttDone) {
+      m_minRttStamp = now;
+      m_mode = PROBE_BW;
+      m_pacingGain = 1;
+      m_cwndGain = 2;
+    }
+  } else if (m_mode != STARTUP && now - m_minRttStamp > m_minRttWindow) {
+    // Drain the queue to refresh the min RTT 
+    m_mode = PROBE_RTT;
+    m_pacingGain = 1;
+    m_probeRttDone = now + std::max (m_minRtt, MilliSeconds (200));
+  }
+}
+
+void
+ReliableUdpBbr::EndRound (uint32_t inFlight)
+{
+  Time now = Simulator::Now ();
+  double bw = m_roundDelivered / (now - m_roundStart).GetSeconds ();
+  m_bwSamples.push_back (bw);
+  if (m_bwSamples.size () > m_bwWindowRounds) {
+    m_bwSamples.pop_front ();
+  }
+  m_btlBw = *std::max_element (m_bwSamples.begin (), m_bwSamples.end ());
+  m_roundStart = now;
+  m_roundDelivered = 0;
+
+  switch (m_mode) {
+    case STARTUP:
+      if (m_btlBw >= 1.25 * m_fullBw) {
+        m_fullBw = m_btlBw;
+        m_fullBwRounds = 0;
+      } else if (++m_fullBwRounds >= 3) {
+        m_mode = DRAIN;
+        m_pacingGain = 1 / g_startupGain;
+      }
+      break;
+    case DRAIN:
+      if (inFlight <= GetBdp ()) {
+        m_mode = PROBE_BW;
+        m_cycleIndex = 0;
+        m_pacingGain = g_probeBwGains[m_cycleIndex];
+        m_cwndGain = 2;
+      }
+      break;
+    case PROBE_BW:
+      m_cycleIndex = (m_cycleIndex + 1) % g_probeBwCycle;
+      m_pacingGain = g_probeBwGains[m_cycleIndex];
+      break;
+    case PROBE_RTT:
+      break;
+  }
+  NS_LOG_DEBUG ("mode " << m_mode << " btlBw " << m_btlBw << " minRtt " << m_minRtt);
+}
+
+double
+ReliableUdpBbr::GetBdp (void) const
+{
+  if (m_meanPacketSize == 0) {
+    return m_initialWindow;
+  }
+  return m_btlBw * m_minRtt.GetSeconds () / m_meanPacketSize;
+}
+
+void
+ReliableUdpBbr::OnLoss (uint32_t inFlight)
+{
+  // The model does not react to individual losses 
+}
+
+void
+ReliableUdpBbr::OnTimeout (void)
+{
+  // Bandwidth samples taken before the timeout no longer hold 
+  m_bwSamples.clear ();
+  m_btlBw = 0;
+}
+
+uint32_t
+ReliableUdpBbr::GetCongestionWindow (void) const
+{
+  if (m_mode == PROBE_RTT) {
+    return g_minPipeWindow;
+  }
+  if (m_btlBw == 0) {
+    return m_initialWindow;
+  }
+  return std::max (uint32_t (m_cwndGain * GetBdp ()), g_minPipeWindow);
+}
+
+DataRate
+ReliableUdpBbr::GetPacingRate (void) const
+{
+  if (m_btlBw == 0) {
+    if (m_minRtt.IsZero () || m_meanPacketSize == 0) {
+      return DataRate (0);
+    }
+    // No bandwidth sample yet; pace the initial window over one RTT 
+    return DataRate (uint64_t (m_pacingGain * m_initialWindow * m_meanPacketSize * 8
+                               / m_minRtt.GetSeconds ()));
+  }
+  return DataRate (uint64_t (m_pacingGain * m_btlBw * 8));
+}
+
+} // namespace ns3
@@ -0,0 +1,180 @@
+#ifndef RELIABLE_UDP_CONGESTION_CONTROL_H
+#define RELIABLE_UDP_CONGESTION_CONTROL_H
+
+#include <stdint.h>
+#include <deque>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Congestion controller interface of ReliableUdpServer.
+ *
+ * The server reports every ack, loss event and retransmission timeout, and 
+ * never keeps more packets in flight than GetCongestionWindow(). A controller 
+ * which also returns a non-zero GetPacingRate() spreads departures at that rate.
+ * The implementation is selected by the CongestionControl attribute of the server.
+ */
+class ReliableUdpCongestionControl : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual ~ReliableUdpCongestionControl ();
+
+  /**
+   * \brief Called when an ack releases packets from the retransmission buffer.
+   * \param packets number of packets newly acked
+   * \param bytes total size of the packets newly acked
+   * \param inFlight number of packets still in flight
+   * \param rtt RTT sample, or zero if the ack yields no valid sample
+   */
+  virtual void OnAck (uint32_t packets, uint32_t bytes, uint32_t inFlight, Time rtt) = 0;
+
+  /**
+   * \brief Called at most once per window when packets are reported lost.
+   * \param inFlight number of packets in flight
+   */
+  virtual void OnLoss (uint32_t inFlight) = 0;
+
+  /**
+   * \brief Called when a retransmission timeout fires.
+   */
+  virtual void OnTimeout (void) = 0;
+
+  /**
+   * \return max number of packets allowed in flight
+   */
+  virtual uint32_t GetCongestionWindow (void) const = 0;
+
+  /**
+   * \return the rate to pace departures at, or 0 if the controller does not pace
+   */
+  virtual DataRate GetPacingRate (void) const;
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Loss-based AIMD: slow start, then additive increase per RTT and 
+ * multiplicative decrease per loss event.
+ */
+class ReliableUdpAimd : public ReliableUdpCongestionControl
+{
+public:
+  static TypeId GetTypeId (void);
+  ReliableUdpAimd ();
+
+  virtual void OnAck (uint32_t packets, uint32_t bytes, uint32_t inFlight, Time rtt);
+  virtual void OnLoss (uint32_t inFlight);
+  virtual void OnTimeout (void);
+  virtual uint32_t GetCongestionWindow (void) const;
+
+private:
+  double m_cwnd;            //!< Congestion window in packets 
+  double m_ssthresh;        //!< Slow start threshold in packets 
+  double m_increase;        //!< Packets added per RTT in congestion avoidance 
+  double m_decrease;        //!< Window is multiplied by it on loss 
+  uint32_t m_minWindow;     //!< Lower bound of the window 
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Delay-gradient controller.
+ *
+ * Once per RTT the smoothed RTT is compared with the one of the previous 
+ * round. A rising RTT means a queue is building, so the window is decreased 
+ * in proportion to the gradient; otherwise it grows additively. Absolute 
+ * thresholds over the min RTT bound the queueing delay, and losses still 
+ * cause a multiplicative decrease.
+ */
+class ReliableUdpDelayGradient : public ReliableUdpCongestionControl
+{
+public:
+  static TypeId GetTypeId (void);
+  ReliableUdpDelayGradient ();
+
+  virtual void OnAck (uint32_t packets, uint32_t bytes, uint32_t inFlight, Time rtt);
+  virtual void OnLoss (uint32_t inFlight);
+  virtual void OnTimeout (void);
+  virtual uint32_t GetCongestionWindow (void) const;
+
+private:
+  double m_cwnd;            //!< Congestion window in packets 
+  double m_increase;        //!< Packets added per RTT when delay is not rising 
+  double m_beta;            //!< Sensitivity of the decrease to the gradient 
+  Time m_lowThreshold;      //!< Queueing delay under which the window always grows 
+  Time m_highThreshold;     //!< Queueing delay over which the window always shrinks 
+  uint32_t m_minWindow;     //!< Lower bound of the window 
+
+  Time m_srtt;              //!< Smoothed RTT 
+  Time m_minRtt;            //!< Min RTT seen so far 
+  Time m_prevRtt;           //!< Smoothed RTT at the end of the previous round 
+  Time m_roundStart;        //!< Start of the current round 
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief BBR-like model-based controller.
+ *
+ * It estimates the bottleneck bandwidth as the max delivery rate of the last 
+ * rounds and the propagation delay as the min RTT of the last seconds, paces 
+ * at gain x bandwidth and caps the window at a multiple of their product. 
+ * It goes through STARTUP, DRAIN, PROBE_BW and PROBE_RTT like BBRv1.
+ */
+class ReliableUdpBbr : public ReliableUdpCongestionControl
+{
+public:
+  static TypeId GetTypeId (void);
+  ReliableUdpBbr ();
+
+  virtual void OnAck (uint32_t packets, uint32_t bytes, uint32_t inFlight, Time rtt);
+  virtual void OnLoss (uint32_t inFlight);
+  virtual void OnTimeout (void);
+  virtual uint32_t GetCongestionWindow (void) const;
+  virtual DataRate GetPacingRate (void) const;
+
+private:
+  /// Modes of the state machine
+  enum Mode { STARTUP, DRAIN, PROBE_BW, PROBE_RTT };
+
+  /**
+   * \brief Close a round: take a delivery rate sample and advance the state machine.
+   * \param inFlight number of packets in flight
+   */
+  void EndRound (uint32_t inFlight);
+
+  /**
+   * \return bandwidth-delay product in packets
+   */
+  double GetBdp (void) const;
+
+  Mode m_mode;                  //!< Current mode 
+  double m_pacingGain;          //!< Current pacing gain 
+  double m_cwndGain;            //!< Window is cwndGain x BDP 
+  uint32_t m_initialWindow;     //!< Window before the first bandwidth sample 
+  uint32_t m_bwWindowRounds;    //!< Rounds kept by the max bandwidth filter 
+  Time m_minRttWindow;          //!< Lifetime of the min RTT sample 
+
+  std::deque<double> m_bwSamples; //!< Delivery rates of recent rounds, bytes/s 
+  double m_btlBw;               //!< Max of m_bwSamples 
+  double m_meanPacketSize;      //!< Average size of acked packets 
+  Time m_minRtt;                //!< Min RTT estimate 
+  Time m_minRttStamp;           //!< When m_minRtt was taken 
+  Time m_roundStart;            //!< Start of the current round 
+  uint64_t m_roundDelivered;    //!< Bytes delivered in the current round 
+  double m_fullBw;              //!< Bandwidth when STARTUP last grew 
+  uint32_t m_fullBwRounds;      //!< Rounds without significant growth 
+  uint32_t m_cycleIndex;        //!< Position in the PROBE_BW gain cycle 
+  Time m_probeRttDone;          //!< End of the current PROBE_RTT 
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_CONGESTION_CONTROL_H */
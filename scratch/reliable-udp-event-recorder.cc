@@ -0,0 +1,107 @@
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "reliable-udp-event-recorder.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpEventRecorder");
+
+namespace {
+
+/**
+ * \brief Write an integer in little endian.
+ * \param p where to write
+ * \param value the integer
+ * \param bytes its size
+ * \return the byte after it
+ */
+inline uint8_t *
+WriteLe (uint8_t *p, uint64_t value, uint32_t bytes)
+{
+  for (uint32_t i = 0; i < bytes; i++) {
+    *p++ = uint8_t (value >> (8 * i));
+  }
+  return p;
+}
+
+} // anonymous namespace
+
+ReliableUdpEventRecorder::ReliableUdpEventRecorder ()
+  : m_file (0),
+    m_used (0),
+    m_nRecords (0)
+{
+}
+
+ReliableUdpEventRecorder::~ReliableUdpEventRecorder ()
+{
+  Close ();
+}
+
+void
+ReliableUdpEventRecorder::Open (std::string filename, uint32_t capacity)
+{
+  NS_LOG_FUNCTION (this << filename << capacity);
+  Close ();
+  m_file = std::fopen (filename.c_str (), "wb");
+  if (m_file == 0) {
+    NS_FATAL_ERROR ("Cannot open event trace " << filename);
+  }
+  m_buffer.resize (std::max (capacity, 1u) * RECORD_SIZE);
+  m_used = 0;
+  m_nRecords = 0;
+
+  uint8_t header[8] = { 'R', 'U', 'E', 'V' };
+  WriteLe (WriteLe (header + 4, FORMAT_VERSION, 2), RECORD_SIZE, 2);
+  std::fwrite (header, 1, sizeof (header), m_file);
+}
+
+void
+ReliableUdpEventRecorder::Close (void)
+{
+  if (m_file == 0) {
+    return;
+  }
+  Flush ();
+  std::fclose (m_file);
+  m_file = 0;
+  NS_LOG_INFO ("Recorded " << m_nRecords << " events");
+}
+
+void
+ReliableUdpEventRecorder::Record (EventType type, uint16_t streamId, uint32_t seq, uint32_t size, uint8_t flags)
+{
+  if (m_file == 0) {
+    return;
+  }
+  if (m_used == m_buffer.size ()) {
+    Flush ();
+  }
+  uint8_t *p = &m_buffer[m_used];
+  p = WriteLe (p, Simulator::Now ().GetNanoSeconds (), 8);
+  *p++ = uint8_t (type);
+  *p++ = flags;
+  p = WriteLe (p, streamId, 2);
+  p = WriteLe (p, seq, 4);
+  WriteLe (p, size, 4);
+  m_used += RECORD_SIZE;
+  m_nRecords++;
+}
+
+uint64_t
+ReliableUdpEventRecorder::GetNRecords (void) const
+{
+  return m_nRecords;
+}
+
+void
+ReliableUdpEventRecorder::Flush (void)
+{
+  if (m_used > 0 && std::fwrite (&m_buffer[0], 1, m_used, m_file) != m_used) {
+    NS_LOG_WARN ("Event trace truncated: write failed");
+  }
+  m_used = 0;
+}
+
+} // namespace ns3
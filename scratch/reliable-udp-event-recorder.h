@@ -0,0 +1,115 @@
+#ifndef RELIABLE_UDP_EVENT_RECORDER_H
+#define RELIABLE_UDP_EVENT_RECORDER_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ * \brief Record per-packet events of an application to a binary file.
+ *
+ * Every event is a fixed-size record written into a buffer allocated once
+ * by Open(); the buffer is written out in one block when it fills up and
+ * on Close(). A record is RECORD_SIZE bytes, little endian:
+ *
+ *     time    int64   simulation time in ns
+ *     type    uint8   EventType
+ *     flags   uint8   EventFlags
+ *     stream  uint16  stream #
+ *     seq     uint32  sequence # or ack #
+ *     size    uint32  bytes, or a count depending on the type
+ *
+ * The file starts with the 4 bytes "RUEV", a uint16 format version and a
+ * uint16 record size. tools/decode-events.py turns it into CSV.
+ * Applications hold no recorder unless asked for one, so recording costs a
+ * null check when disabled.
+ */
+class ReliableUdpEventRecorder : public SimpleRefCount<ReliableUdpEventRecorder>
+{
+public:
+  /// What happened
+  enum EventType
+  {
+    TX_DATA = 1,       //!< Server sent a data packet; size is its size
+    TX_PARITY = 2,     //!< Server sent a FEC parity packet
+    TX_PROBE = 3,      //!< Server probed a zero window
+    RX_ACK = 4,        //!< Server got an ack; seq is the ack #, size the packets it released
+    LOSS = 5,          //!< Server declared a packet lost
+    ABANDON = 6,       //!< Server gave up on a packet past its deadline
+    TX_DROP = 7,       //!< Server dropped a packet at a full TX queue
+    RX_DATA = 8,       //!< Client got a data packet
+    RX_PARITY = 9,     //!< Client got a FEC parity packet
+    FEC_RECOVERED = 10, //!< Client rebuilt a data packet from parity
+    RX_DROP = 11,      //!< Client dropped a packet beyond its reorder window
+    TX_ACK = 12,       //!< Client sent an ack; seq is the ack #, size the window edge
+    FRAME_PLAYED = 13, //!< Client played a frame; seq is the frame #, size its bytes
+    STALL = 14,        //!< Client ran out of frames to play
+    TX_KEEPALIVE = 15, //!< Server sent a keepalive; seq is the next seq #
+    TX_NACK = 16,      //!< Client sent a NACK; seq is its first seq #, size the packets asked for
+    RX_NACK = 17       //!< Server got a NACK; seq is its first seq #, size the packets queued for a resend
+  };
+
+  /// Bits of the flags of a record
+  enum EventFlags
+  {
+    RETRANSMIT = 0x01, //!< The packet is a retransmission
+    DUPLICATE = 0x02,  //!< The packet was received before
+    OUT_OF_ORDER = 0x04, //!< The packet arrived ahead of a missing one
+    LATE = 0x08,       //!< The frame was played past its deadline
+    SKIPPED = 0x10     //!< The packet arrived after the client stopped waiting for it
+  };
+
+  static const uint32_t RECORD_SIZE = 20; //!< Bytes of a record
+  static const uint16_t FORMAT_VERSION = 1; //!< Version of the file format
+
+  ReliableUdpEventRecorder ();
+  ~ReliableUdpEventRecorder ();
+
+  /**
+   * \brief Create a file and write its header.
+   * \param filename the file
+   * \param capacity number of records buffered before they are written out
+   */
+  void Open (std::string filename, uint32_t capacity);
+
+  /**
+   * \brief Write out the buffered records and close the file.
+   * It is called by the destructor as well.
+   */
+  void Close (void);
+
+  /**
+   * \brief Buffer a record stamped with the current simulation time.
+   * \param type what happened
+   * \param streamId the stream
+   * \param seq sequence # or ack #
+   * \param size bytes or a count, depending on type
+   * \param flags EventFlags
+   */
+  void Record (EventType type, uint16_t streamId, uint32_t seq, uint32_t size, uint8_t flags = 0);
+
+  /**
+   * \return number of records written to the file or buffered
+   */
+  uint64_t GetNRecords (void) const;
+
+private:
+  /**
+   * \brief Write the buffered records to the file.
+   */
+  void Flush (void);
+
+  std::FILE *m_file;          //!< The file; 0 when closed
+  std::vector<uint8_t> m_buffer; //!< Records not written out yet
+  uint32_t m_used;            //!< Bytes of m_buffer in use
+  uint64_t m_nRecords;        //!< Records recorded since Open()
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_EVENT_RECORDER_H */
@@ -0,0 +1,607 @@
+#include <string.h>
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "reliable-udp-fec.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpFec");
+
+uint8_t ReliableUdpFec::s_exp[512];
+uint8_t ReliableUdpFec::s_log[256];
+bool ReliableUdpFec::s_init = false;
+
+/// Bytes of header fields carried at the start of every data symbol 
+static const uint32_t FEC_SYMBOL_META = 19;
+
+/**
+ * \brief Copy the payload of a packet, past its header, without copying the packet.
+ * \param packet the packet
+ * \param headerSize size of its header
+ * \param out destination of the payload
+ * \param scratch room for the whole packet; grown when it is too small
+ */
+static void
+CopyPayload (Ptr<const Packet> packet, uint32_t headerSize, uint8_t *out, std::vector<uint8_t> &scratch)
+{
+  uint32_t size = packet->GetSize ();
+  if (scratch.size () < size) {
+    scratch.resize (size);
+  }
+  packet->CopyData (&scratch[0], size);
+  memcpy (out, &scratch[headerSize], size - headerSize);
+}
+
+/**
+ * \brief Write the symbol of a data packet: payload length, the header 
+ * fields needed to rebuild the packet, then the payload.
+ * \param s destination, at least FEC_SYMBOL_META + payload size bytes
+ * \param header header of the packet
+ * \param packet the packet, including its header
+ * \param headerSize size of the header
+ * \param scratch room for a copy of the whole packet
+ */
+static void
+WriteSymbol (uint8_t *s, ReliableUdpHeader &header, Ptr<const Packet> packet, uint32_t headerSize,
+             std::vector<uint8_t> &scratch)
+{
+  uint32_t len = packet->GetSize () - headerSize;
+  uint32_t deadline = header.GetDeadline ().GetMilliSeconds ();
+  s[0] = len >> 8;
+  s[1] = len;
+  for (uint32_t b = 0; b < 4; b++) {
+    s[2 + b] = header.GetSeqNum () >> (24 - 8 * b);
+    s[6 + b] = header.GetFrameId () >> (24 - 8 * b);
+    s[15 + b] = deadline >> (24 - 8 * b);
+  }
+  s[10] = header.GetFragIndex () >> 8;
+  s[11] = header.GetFragIndex ();
+  s[12] = header.GetFragCount () >> 8;
+  s[13] = header.GetFragCount ();
+  s[14] = header.GetFrameType ();
+  CopyPayload (packet, headerSize, s + FEC_SYMBOL_META, scratch);
+}
+
+void
+ReliableUdpFec::InitTables (void)
+{
+  // GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 and generator 2 
+  uint32_t x = 1;
+  for (uint32_t i = 0; i < 255; i++) {
+    s_exp[i] = x;
+    s_log[x] = i;
+    x <<= 1;
+    if (x & 0x100) {
+      x ^= 0x11d;
+    }
+  }
+  for (uint32_t i = 255; i < 512; i++) {
+    s_exp[i] = s_exp[i - 255];
+  }
+  s_log[0] = 0;
+  s_init = true;
+}
+
+uint8_t
+ReliableUdpFec::Mul (uint8_t a, uint8_t b)
+{
+  if (!s_init) {
+    InitTables ();
+  }
+  if (a == 0 || b == 0) {
+    return 0;
+  }
+  return s_exp[s_log[a] + s_log[b]];
+}
+
+uint8_t
+ReliableUdpFec::Inv (uint8_t a)
+{
+  NS_ASSERT (a != 0);
+  if (!s_init) {
+    InitTables ();
+  }
+  return s_exp[255 - s_log[a]];
+}
+
+uint8_t
+ReliableUdpFec::Coefficient (uint32_t j, uint32_t i, uint32_t m)
+{
+  // Cauchy matrix 1 / (x_j + y_i) with x_j = j and y_i = m + i; every 
+  // square submatrix of it is invertible 
+  return Inv (uint8_t (j ^ (m + i)));
+}
+
+void
+ReliableUdpFec::XorRegion (uint8_t *dst, const uint8_t *src, uint32_t len)
+{
+  uint32_t i = 0;
+  // Word at a time; memcpy keeps it legal for any alignment and 
+  // compiles to plain loads, which the compiler vectorizes 
+  for (; i + 8 <= len; i += 8) {
+    uint64_t a, b;
+    memcpy (&a, dst + i, 8);
+    memcpy (&b, src + i, 8);
+    a ^= b;
+    memcpy (dst + i, &a, 8);
+  }
+  for (; i < len; i++) {
+    dst[i] ^= src[i];
+  }
+}
+
+void
+ReliableUdpFec::MulAddRegion (uint8_t *dst, const uint8_t *src, uint8_t c, uint32_t len)
+{
+  if (c == 0) {
+    return;
+  }
+  if (c == 1) {
+    XorRegion (dst, src, len);
+    return;
+  }
+  // c * b = c * (b & 0x0f) + c * (b & 0xf0); two 16 entry tables per 
+  // coefficient fit in a register each 
+  uint8_t lo[16], hi[16];
+  for (uint32_t x = 0; x < 16; x++) {
+    lo[x] = Mul (c, x);
+    hi[x] = Mul (c, x << 4);
+  }
+  uint32_t i = 0;
+#if defined(__SSSE3__)
+  const __m128i tlo = _mm_loadu_si128 ((const __m128i *) lo);
+  const __m128i thi = _mm_loadu_si128 ((const __m128i *) hi);
+  const __m128i mask = _mm_set1_epi8 (0x0f);
+  for (; i + 16 <= len; i += 16) {
+    __m128i s = _mm_loadu_si128 ((const __m128i *) (src + i));
+    __m128i d = _mm_loadu_si128 ((const __m128i *) (dst + i));
+    __m128i l = _mm_shuffle_epi8 (tlo, _mm_and_si128 (s, mask));
+    __m128i h = _mm_shuffle_epi8 (thi, _mm_and_si128 (_mm_srli_epi64 (s, 4), mask));
+    d = _mm_xor_si128 (d, _mm_xor_si128 (l, h));
+    _mm_storeu_si128 ((__m128i *) (dst + i), d);
+  }
+#endif
+  for (; i < len; i++) {
+    dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+  }
+}
+
+void
+ReliableUdpFec::Encode (Mode mode, const uint8_t *data, uint32_t k,
+                        uint8_t *parity, uint32_t m, uint32_t size)
+{
+  NS_ASSERT (k + m <= 256);
+  if (mode == XOR) {
+    m = 1;
+  }
+  memset (parity, 0, m * size);
+  for (uint32_t j = 0; j < m; j++) {
+    for (uint32_t i = 0; i < k; i++) {
+      if (mode == XOR) {
+        XorRegion (parity, data + i * size, size);
+      } else {
+        MulAddRegion (parity + j * size, data + i * size, Coefficient (j, i, m), size);
+      }
+    }
+  }
+}
+
+bool
+ReliableUdpFec::Decode (Mode mode, uint8_t *data, const bool *dataPresent, uint32_t k,
+                        const uint8_t *parity, const bool *parityPresent, uint32_t m,
+                        uint32_t size)
+{
+  if (mode == XOR) {
+    m = 1;
+  }
+  std::vector<uint32_t> erased;
+  for (uint32_t i = 0; i < k; i++) {
+    if (!dataPresent[i]) {
+      erased.push_back (i);
+    }
+  }
+  std::vector<uint32_t> rows;
+  for (uint32_t j = 0; j < m && rows.size () < erased.size (); j++) {
+    if (parityPresent[j]) {
+      rows.push_back (j);
+    }
+  }
+  if (erased.empty ()) {
+    return true;
+  }
+  if (rows.size () < erased.size ()) {
+    return false;
+  }
+
+  if (mode == XOR) {
+    uint8_t *out = data + erased[0] * size;
+    memcpy (out, parity, size);
+    for (uint32_t i = 0; i < k; i++) {
+      if (i != erased[0]) {
+        XorRegion (out, data + i * size, size);
+      }
+    }
+    return true;
+  }
+
+  // Syndromes: each chosen parity minus the contribution of the data 
+  // that is present leaves a combination of the erased symbols only 
+  uint32_t e = erased.size ();
+  std::vector<uint8_t> syndromes (e * size);
+  for (uint32_t r = 0; r < e; r++) {
+    uint8_t *s = &syndromes[r * size];
+    memcpy (s, parity + rows[r] * size, size);
+    for (uint32_t i = 0; i < k; i++) {
+      if (dataPresent[i]) {
+        MulAddRegion (s, data + i * size, Coefficient (rows[r], i, m), size);
+      }
+    }
+  }
+
+  // Invert the e x e Cauchy submatrix by Gauss-Jordan elimination 
+  std::vector<uint8_t> a (e * e), inv (e * e, 0);
+  for (uint32_t r = 0; r < e; r++) {
+    for (uint32_t c = 0; c < e; c++) {
+      a[r * e + c] = Coefficient (rows[r], erased[c], m);
+    }
+    inv[r * e + r] = 1;
+  }
+  for (uint32_t c = 0; c < e; c++) {
+    uint32_t pivot = c;
+    while (a[pivot * e + c] == 0) {
+      pivot++;
+      NS_ASSERT (pivot < e);
+    }
+    if (pivot != c) {
+      for (uint32_t x = 0; x < e; x++) {
+        std::swap (a[pivot * e + x], a[c * e + x]);
+        std::swap (inv[pivot * e + x], inv[c * e + x]);
+      }
+    }
+    uint8_t f = Inv (a[c * e + c]);
+    for (uint32_t x = 0; x < e; x++) {
+      a[c * e + x] = Mul (f, a[c * e + x]);
+      inv[c * e + x] = Mul (f, inv[c * e + x]);
+    }
+    for (uint32_t r = 0; r < e; r++) {
+      uint8_t g = a[r * e + c];
+      if (r == c || g == 0) {
+        continue;
+      }
+      for (uint32_t x = 0; x < e; x++) {
+        a[r * e + x] ^= Mul (g, a[c * e + x]);
+        inv[r * e + x] ^= Mul (g, inv[c * e + x]);
+      }
+    }
+  }
+
+  for (uint32_t r = 0; r < e; r++) {
+    uint8_t *out = data + erased[r] * size;
+    memset (out, 0, size);
+    for (uint32_t c = 0; c < e; c++) {
+      MulAddRegion (out, &syndromes[c * size], inv[r * e + c], size);
+    }
+  }
+  return true;
+}
+
+ReliableUdpFecEncoder::ReliableUdpFecEncoder ()
+  : m_mode (ReliableUdpFec::NONE),
+    m_k (0),
+    m_m (0),
+    m_maxSymbolSize (0),
+    m_count (0),
+    m_base (0),
+    m_symbolSize (0)
+{
+}
+
+void
+ReliableUdpFecEncoder::Configure (ReliableUdpFec::Mode mode, uint32_t k, uint32_t m, uint32_t maxPayloadSize)
+{
+  NS_ASSERT_MSG (mode == ReliableUdpFec::NONE || (k > 0 && m > 0 && k + m <= 256),
+                 "FEC needs 0 < K, 0 < M and K + M <= 256");
+  m_mode = mode;
+  m_k = k;
+  m_m = mode == ReliableUdpFec::XOR ? 1 : m;
+  m_maxSymbolSize = FEC_SYMBOL_META + maxPayloadSize;
+  m_count = 0;
+  m_symbolSize = 0;
+  if (m_mode != ReliableUdpFec::NONE) {
+    // Allocated once; blocks are encoded in place 
+    m_data.assign (m_k * m_maxSymbolSize, 0);
+    m_packed.assign (m_k * m_maxSymbolSize, 0);
+    m_parity.assign (m_m * m_maxSymbolSize, 0);
+  }
+}
+
+bool
+ReliableUdpFecEncoder::IsEnabled (void) const
+{
+  return m_mode != ReliableUdpFec::NONE;
+}
+
+void
+ReliableUdpFecEncoder::AddPacket (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &parity)
+{
+  if (!IsEnabled ()) {
+    return;
+  }
+  ReliableUdpHeader header;
+  uint32_t headerSize = packet->PeekHeader (header);
+  uint32_t len = packet->GetSize () - headerSize;
+  NS_ASSERT (FEC_SYMBOL_META + len <= m_maxSymbolSize);
+  if (m_count == 0) {
+    m_base = header.GetSeqNum ();
+  }
+  NS_ASSERT (header.GetSeqNum () == m_base + m_count);
+
+  uint8_t *s = &m_data[m_count * m_maxSymbolSize];
+  WriteSymbol (s, header, packet, headerSize, m_packet);
+  m_symbolSize = std::max (m_symbolSize, FEC_SYMBOL_META + len);
+
+  if (++m_count == m_k) {
+    Flush (parity);
+  }
+}
+
+void
+ReliableUdpFecEncoder::Flush (std::vector<Ptr<Packet> > &parity)
+{
+  if (m_count == 0) {
+    return;
+  }
+  // Symbols of a block are padded with zeros to the largest of them and 
+  // packed back to back, so the kernels run over one contiguous region 
+  uint32_t size = m_symbolSize;
+  for (uint32_t i = 0; i < m_count; i++) {
+    uint8_t *src = &m_data[i * m_maxSymbolSize];
+    uint32_t len = FEC_SYMBOL_META + ((src[0] << 8) | src[1]);
+    memcpy (&m_packed[i * size], src, len);
+    memset (&m_packed[i * size + len], 0, size - len);
+  }
+  ReliableUdpFec::Encode (m_mode, &m_packed[0], m_count, &m_parity[0], m_m, size);
+
+  for (uint32_t j = 0; j < m_m; j++) {
+    Ptr<Packet> p = Create<Packet> (&m_parity[j * size], size);
+    ReliableUdpHeader header;
+    header.SetFec (m_mode, m_base, m_count, m_m, j);
+    p->AddHeader (header);
+    parity.push_back (p);
+  }
+  m_count = 0;
+  m_symbolSize = 0;
+}
+
+uint32_t
+ReliableUdpFecEncoder::GetMemoryUsage (void) const
+{
+  return m_data.capacity () + m_packed.capacity () + m_parity.capacity () + m_packet.capacity ();
+}
+
+ReliableUdpFecDecoder::ReliableUdpFecDecoder ()
+  : m_history (0),
+    m_maxSymbolSize (0),
+    m_highestSeq (0),
+    m_recovered (0),
+    m_unrecovered (0)
+{
+}
+
+void
+ReliableUdpFecDecoder::Configure (uint32_t history, uint32_t maxSymbolSize)
+{
+  m_history = history;
+  m_maxSymbolSize = maxSymbolSize;
+  m_symbols.assign (history * maxSymbolSize, 0);
+  m_slotSeq.assign (history, 0);
+  m_slotValid.assign (history, false);
+  m_pending.clear ();
+}
+
+bool
+ReliableUdpFecDecoder::HasData (uint32_t seq) const
+{
+  uint32_t slot = seq % m_history;
+  return m_slotValid[slot] && m_slotSeq[slot] == seq;
+}
+
+void
+ReliableUdpFecDecoder::CommitSlot (uint32_t seq)
+{
+  uint32_t slot = seq % m_history;
+  m_slotSeq[slot] = seq;
+  m_slotValid[slot] = true;
+  if (int32_t (seq - m_highestSeq) > 0) {
+    m_highestSeq = seq;
+  }
+}
+
+void
+ReliableUdpFecDecoder::AddData (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &recovered)
+{
+  if (m_history == 0) {
+    return;
+  }
+  ReliableUdpHeader header;
+  uint32_t headerSize = packet->PeekHeader (header);
+  uint32_t len = packet->GetSize () - headerSize;
+  uint32_t seq = header.GetSeqNum ();
+  if (FEC_SYMBOL_META + len > m_maxSymbolSize || HasData (seq)) {
+    return;
+  }
+  uint8_t *s = &m_symbols[(seq % m_history) * m_maxSymbolSize];
+  WriteSymbol (s, header, packet, headerSize, m_packet);
+  CommitSlot (seq);
+
+  // The map order breaks where seq #s wrap, so look at every pending block 
+  for (std::map<uint32_t, PendingBlock>::iterator it = m_pending.begin (); it != m_pending.end (); ++it) {
+    if (seq - it->first < it->second.k) {
+      TryDecode (it, recovered);
+      break;
+    }
+  }
+  Expire ();
+}
+
+void
+ReliableUdpFecDecoder::AddParity (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &recovered)
+{
+  if (m_history == 0) {
+    return;
+  }
+  ReliableUdpHeader header;
+  uint32_t headerSize = packet->PeekHeader (header);
+  uint32_t base = header.GetFecBlock ();
+  uint32_t size = packet->GetSize () - headerSize;
+  uint32_t k = header.GetFecK ();
+  uint32_t m = header.GetFecM ();
+  uint32_t index = header.GetFecIndex ();
+  if (size > m_maxSymbolSize || index >= m || k > m_history) {
+    return;
+  }
+  if (int32_t (m_highestSeq - base) >= int32_t (m_history)) {
+    // Too old; its data may have left the ring 
+    return;
+  }
+
+  std::map<uint32_t, PendingBlock>::iterator it = m_pending.find (base);
+  if (it == m_pending.end ()) {
+    bool complete = true;
+    for (uint32_t i = 0; i < k && complete; i++) {
+      complete = HasData (base + i);
+    }
+    if (complete) {
+      return;
+    }
+    PendingBlock block;
+    block.mode = ReliableUdpFec::Mode (header.GetFecMode ());
+    block.k = k;
+    block.m = m;
+    block.symbolSize = size;
+    block.parity.assign (m * size, 0);
+    block.present.assign (m, false);
+    it = m_pending.insert (std::make_pair (base, block)).first;
+  }
+  PendingBlock &block = it->second;
+  if (block.present[index] || block.symbolSize != size) {
+    return;
+  }
+  CopyPayload (packet, headerSize, &block.parity[index * size], m_packet);
+  block.present[index] = true;
+  if (int32_t (base + k - 1 - m_highestSeq) > 0) {
+    m_highestSeq = base + k - 1;
+  }
+  TryDecode (it, recovered);
+  Expire ();
+}
+
+void
+ReliableUdpFecDecoder::TryDecode (std::map<uint32_t, PendingBlock>::iterator it,
+                                  std::vector<Ptr<Packet> > &recovered)
+{
+  uint32_t base = it->first;
+  PendingBlock &block = it->second;
+  uint32_t size = block.symbolSize;
+
+  uint32_t missing = 0;
+  uint32_t parities = 0;
+  bool dataPresent[256];
+  bool parityPresent[256];
+  for (uint32_t i = 0; i < block.k; i++) {
+    dataPresent[i] = HasData (base + i);
+    missing += !dataPresent[i];
+  }
+  for (uint32_t j = 0; j < block.m; j++) {
+    parityPresent[j] = block.present[j];
+    parities += parityPresent[j];
+  }
+  if (missing == 0) {
+    m_pending.erase (it);
+    return;
+  }
+  if (parities < missing) {
+    return;
+  }
+
+  // Gather the block into one contiguous region and decode it in place 
+  m_work.assign (block.k * size, 0);
+  for (uint32_t i = 0; i < block.k; i++) {
+    if (dataPresent[i]) {
+      const uint8_t *s = &m_symbols[((base + i) % m_history) * m_maxSymbolSize];
+      uint32_t len = FEC_SYMBOL_META + ((s[0] << 8) | s[1]);
+      memcpy (&m_work[i * size], s, std::min (len, size));
+    }
+  }
+  if (!ReliableUdpFec::Decode (block.mode, &m_work[0], dataPresent, block.k,
+                               &block.parity[0], parityPresent, block.m, size)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < block.k; i++) {
+    if (dataPresent[i]) {
+      continue;
+    }
+    const uint8_t *s = &m_work[i * size];
+    uint32_t len = (s[0] << 8) | s[1];
+    uint32_t seq = 0, frameId = 0, deadline = 0;
+    for (uint32_t b = 0; b < 4; b++) {
+      seq = (seq << 8) | s[2 + b];
+      frameId = (frameId << 8) | s[6 + b];
+      deadline = (deadline << 8) | s[15 + b];
+    }
+    if (seq != base + i || FEC_SYMBOL_META + len > size) {
+      NS_LOG_WARN ("Corrupt FEC symbol in block " << base);
+      continue;
+    }
+    ReliableUdpHeader header;
+    header.SetSeqNum (seq);
+    header.SetFrameId (frameId);
+    header.SetFragment ((s[10] << 8) | s[11], (s[12] << 8) | s[13]);
+    header.SetFrameType (s[14]);
+    header.SetDeadline (MilliSeconds (deadline));
+    Ptr<Packet> p = Create<Packet> (s + FEC_SYMBOL_META, len);
+    p->AddHeader (header);
+    memcpy (&m_symbols[(seq % m_history) * m_maxSymbolSize], s, FEC_SYMBOL_META + len);
+    CommitSlot (seq);
+    recovered.push_back (p);
+    m_recovered++;
+  }
+  NS_LOG_INFO ("Recovered " << missing << " packets of FEC block " << base);
+  m_pending.erase (it);
+}
+
+void
+ReliableUdpFecDecoder::Expire (void)
+{
+  // The oldest block is not the first one in the map once seq #s wrap 
+  std::map<uint32_t, PendingBlock>::iterator it = m_pending.begin ();
+  while (it != m_pending.end ()) {
+    if (int32_t (m_highestSeq - it->first) < int32_t (m_history)) {
+      ++it;
+      continue;
+    }
+    for (uint32_t i = 0; i < it->second.k; i++) {
+      m_unrecovered += !HasData (it->first + i);
+    }
+    m_pending.erase (it++);
+  }
+}
+
+uint32_t
+ReliableUdpFecDecoder::GetRecovered (void) const
+{
+  return m_recovered;
+}
+
+uint32_t
+ReliableUdpFecDecoder::GetUnrecovered (void) const
+{
+  return m_unrecovered;
+}
+
+} // namespace ns3
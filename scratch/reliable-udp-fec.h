@@ -0,0 +1,230 @@
+#ifndef RELIABLE_UDP_FEC_H
+#define RELIABLE_UDP_FEC_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "reliable-udp-header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup reliableudp
+ * \brief Erasure coding kernels on contiguous buffers.
+ *
+ * A block is K data symbols and M parity symbols of the same size, each 
+ * stored contiguously. XOR mode has a single parity symbol. Reed-Solomon 
+ * mode uses a systematic Cauchy matrix over GF(2^8), so any K of the K + M 
+ * symbols rebuild the block. Region operations work on whole symbols at a 
+ * time and use SSSE3 shuffles when the compiler targets it.
+ */
+class ReliableUdpFec
+{
+public:
+  /// Coding modes
+  enum Mode
+  {
+    NONE = 0,         //!< No FEC 
+    XOR = 1,          //!< One XOR parity per block 
+    REED_SOLOMON = 2  //!< M Reed-Solomon parities per block 
+  };
+
+  /**
+   * \brief dst ^= src
+   */
+  static void XorRegion (uint8_t *dst, const uint8_t *src, uint32_t len);
+
+  /**
+   * \brief dst ^= c * src over GF(2^8)
+   */
+  static void MulAddRegion (uint8_t *dst, const uint8_t *src, uint8_t c, uint32_t len);
+
+  /**
+   * \brief Compute the parity symbols of a block.
+   * \param mode XOR or REED_SOLOMON; XOR uses only the first parity symbol
+   * \param data k data symbols, stored back to back
+   * \param k number of data symbols
+   * \param parity m parity symbols, stored back to back
+   * \param m number of parity symbols
+   * \param size symbol size in bytes
+   */
+  static void Encode (Mode mode, const uint8_t *data, uint32_t k,
+                      uint8_t *parity, uint32_t m, uint32_t size);
+
+  /**
+   * \brief Rebuild missing data symbols of a block in place.
+   * \param dataPresent which data symbols are valid
+   * \param parityPresent which parity symbols are valid
+   * \return false if too few symbols are present
+   */
+  static bool Decode (Mode mode, uint8_t *data, const bool *dataPresent, uint32_t k,
+                      const uint8_t *parity, const bool *parityPresent, uint32_t m,
+                      uint32_t size);
+
+  static uint8_t Mul (uint8_t a, uint8_t b);
+  static uint8_t Inv (uint8_t a);
+
+private:
+  /**
+   * \return the Cauchy coefficient of data symbol i in parity symbol j
+   */
+  static uint8_t Coefficient (uint32_t j, uint32_t i, uint32_t m);
+
+  /**
+   * \brief Build the log/exp tables once.
+   */
+  static void InitTables (void);
+
+  static uint8_t s_exp[512];  //!< Antilog table, doubled to skip a modulo 
+  static uint8_t s_log[256];  //!< Log table 
+  static bool s_init;         //!< Whether the tables were built 
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Groups outgoing data packets into blocks and makes their parity packets.
+ *
+ * Each data packet becomes one symbol: the header fields the client needs 
+ * to rebuild it, followed by its payload. A block is closed when it holds 
+ * K packets or at the end of a frame, whichever comes first.
+ */
+class ReliableUdpFecEncoder
+{
+public:
+  ReliableUdpFecEncoder ();
+
+  /**
+   * \param mode coding mode; NONE disables the encoder
+   * \param k max data packets per block
+   * \param m parity packets per block; forced to 1 in XOR mode
+   * \param maxPayloadSize max payload of a data packet
+   */
+  void Configure (ReliableUdpFec::Mode mode, uint32_t k, uint32_t m, uint32_t maxPayloadSize);
+
+  bool IsEnabled (void) const;
+
+  /**
+   * \brief Add a data packet to the current block.
+   * \param packet the packet, including its ReliableUdpHeader
+   * \param parity receives the parity packets if the block got full
+   */
+  void AddPacket (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &parity);
+
+  /**
+   * \brief Close the current block, even if it is not full.
+   * \param parity receives the parity packets, including their headers
+   */
+  void Flush (std::vector<Ptr<Packet> > &parity);
+
+  /**
+   * \return bytes taken by the block buffers
+   */
+  uint32_t GetMemoryUsage (void) const;
+
+private:
+  ReliableUdpFec::Mode m_mode;     //!< Coding mode 
+  uint32_t m_k;                    //!< Max data packets per block 
+  uint32_t m_m;                    //!< Parity packets per block 
+  uint32_t m_maxSymbolSize;        //!< Size of a row of m_data 
+  std::vector<uint8_t> m_data;     //!< Data symbols of the current block 
+  std::vector<uint8_t> m_parity;   //!< Parity symbols of the current block 
+  std::vector<uint8_t> m_packed;   //!< Data symbols repacked at the block symbol size 
+  std::vector<uint8_t> m_packet;   //!< Scratch copy of a whole packet 
+  uint32_t m_count;                //!< Data packets in the current block 
+  uint32_t m_base;                 //!< Seq # of the first packet of the block 
+  uint32_t m_symbolSize;           //!< Largest symbol of the current block 
+};
+
+/**
+ * \ingroup reliableudpclient
+ * \brief Rebuilds lost data packets from received data and parity packets.
+ *
+ * Symbols of recently received data packets are kept in a ring indexed by 
+ * sequence #, and parity packets of blocks that miss data are kept until 
+ * the block is decoded or falls behind the ring.
+ */
+class ReliableUdpFecDecoder
+{
+public:
+  ReliableUdpFecDecoder ();
+
+  /**
+   * \param history number of recent data symbols kept
+   * \param maxSymbolSize max size of a symbol in bytes
+   */
+  void Configure (uint32_t history, uint32_t maxSymbolSize);
+
+  /**
+   * \brief Record a received data packet and decode the blocks it completes.
+   * \param packet the packet, including its ReliableUdpHeader
+   * \param recovered receives the rebuilt packets, including their headers
+   */
+  void AddData (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &recovered);
+
+  /**
+   * \brief Record a received parity packet and decode its block if possible.
+   * \param packet the packet, including its ReliableUdpHeader
+   * \param recovered receives the rebuilt packets, including their headers
+   */
+  void AddParity (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &recovered);
+
+  /**
+   * \return packets rebuilt so far
+   */
+  uint32_t GetRecovered (void) const;
+
+  /**
+   * \return data packets that were missing from blocks given up on
+   */
+  uint32_t GetUnrecovered (void) const;
+
+private:
+  /// Parity received for a block that misses data
+  struct PendingBlock
+  {
+    ReliableUdpFec::Mode mode;     //!< Coding mode 
+    uint32_t k;                    //!< Data packets in the block 
+    uint32_t m;                    //!< Parity packets in the block 
+    uint32_t symbolSize;           //!< Symbol size of the block 
+    std::vector<uint8_t> parity;   //!< m parity symbols 
+    std::vector<bool> present;     //!< Which parity symbols were received 
+  };
+
+  /**
+   * \return whether the symbol of seq is held
+   */
+  bool HasData (uint32_t seq) const;
+
+  /**
+   * \brief Try to decode a block; it is erased when done.
+   */
+  void TryDecode (std::map<uint32_t, PendingBlock>::iterator it, std::vector<Ptr<Packet> > &recovered);
+
+  /**
+   * \brief Mark the slot of seq as holding its symbol.
+   */
+  void CommitSlot (uint32_t seq);
+
+  /**
+   * \brief Give up blocks which fell behind the ring.
+   */
+  void Expire (void);
+
+  uint32_t m_history;                  //!< Number of slots in the ring 
+  uint32_t m_maxSymbolSize;            //!< Size of a slot 
+  std::vector<uint8_t> m_symbols;      //!< Ring of data symbols 
+  std::vector<uint32_t> m_slotSeq;     //!< Seq # held by each slot 
+  std::vector<bool> m_slotValid;       //!< Whether each slot is used 
+  uint32_t m_highestSeq;               //!< Highest seq # seen 
+  std::map<uint32_t, PendingBlock> m_pending; //!< Blocks missing data, by base seq # 
+  std::vector<uint8_t> m_work;         //!< Contiguous scratch for decoding 
+  std::vector<uint8_t> m_packet;       //!< Scratch copy of a whole packet 
+  uint32_t m_recovered;                //!< Packets rebuilt 
+  uint32_t m_unrecovered;              //!< Packets lost in expired blocks 
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_FEC_H */
@@ -0,0 +1,264 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "reliable-udp-frame-source.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpFrameSource");
+
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpFrameSource);
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpTraceFrameSource);
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpGopFrameSource);
+
+TypeId
+ReliableUdpFrameSource::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpFrameSource")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    ;
+  return tid;
+}
+
+ReliableUdpFrameSource::~ReliableUdpFrameSource ()
+{
+}
+
+bool
+ReliableUdpFrameSource::SetBitrate (DataRate bitrate)
+{
+  return false;
+}
+
+int64_t
+ReliableUdpFrameSource::AssignStreams (int64_t stream)
+{
+  return 0;
+}
+
+/* ReliableUdpTraceFrameSource */
+
+TypeId
+ReliableUdpTraceFrameSource::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpTraceFrameSource")
+    .SetParent<ReliableUdpFrameSource> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpTraceFrameSource> ()
+    .AddAttribute ("TraceFile", "Path of the frame-size trace",
+                   StringValue (""),
+                   MakeStringAccessor (&ReliableUdpTraceFrameSource::m_traceFile),
+                   MakeStringChecker ())
+    .AddAttribute ("Loop", "Whether to restart the trace when it ends",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&ReliableUdpTraceFrameSource::m_loop),
+                   MakeBooleanChecker ())
+    ;
+  return tid;
+}
+
+ReliableUdpTraceFrameSource::ReliableUdpTraceFrameSource ()
+  : m_loop (true),
+    m_frames (0),
+    m_next (0),
+    m_nextId (0),
+    m_scale (1)
+{
+}
+
+void
+ReliableUdpTraceFrameSource::Load (void)
+{
+  static std::map<std::string, std::vector<Frame> > traces;
+  std::map<std::string, std::vector<Frame> >::iterator it = traces.find (m_traceFile);
+  if (it != traces.end ()) {
+    m_frames = &it->second;
+    return;
+  }
+  std::vector<Frame> &frames = traces[m_traceFile];
+  std::ifstream in (m_traceFile.c_str ());
+  if (!in.is_open ()) {
+    NS_FATAL_ERROR ("Cannot open frame trace " << m_traceFile);
+  }
+  std::string line;
+  while (std::getline (in, line)) {
+    if (line.empty () || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields (line);
+    double timestampMs;
+    char type;
+    uint32_t size;
+    if (!(fields >> timestampMs >> type >> size)) {
+      NS_FATAL_ERROR ("Malformed line in frame trace " << m_traceFile << ": " << line);
+    }
+    Frame frame;
+    frame.id = 0;
+    frame.type = type == 'I' ? I_FRAME : (type == 'B' ? B_FRAME : P_FRAME);
+    frame.size = size;
+    frame.timestamp = MicroSeconds (uint64_t (timestampMs * 1000));
+    frames.push_back (frame);
+  }
+  m_frames = &frames;
+  NS_LOG_INFO ("Loaded " << frames.size () << " frames from " << m_traceFile);
+}
+
+bool
+ReliableUdpTraceFrameSource::GetNextFrame (Frame &frame)
+{
+  if (m_frames == 0) {
+    Load ();
+  }
+  const std::vector<Frame> &frames = *m_frames;
+  if (m_next == frames.size ()) {
+    if (!m_loop || frames.empty ()) {
+      return false;
+    }
+    // The next loop starts one frame interval after the last frame 
+    Time interval = frames.size () > 1
+      ? frames[frames.size () - 1].timestamp - frames[frames.size () - 2].timestamp
+      : MilliSeconds (33);
+    m_loopOffset += frames.back ().timestamp + interval;
+    m_next = 0;
+  }
+  frame = frames[m_next++];
+  frame.id = m_nextId++;
+  frame.size = std::max (uint32_t (frame.size * m_scale), uint32_t (1));
+  frame.timestamp += m_loopOffset;
+  return true;
+}
+
+bool
+ReliableUdpTraceFrameSource::SetBitrate (DataRate bitrate)
+{
+  if (m_frames == 0) {
+    Load ();
+  }
+  const std::vector<Frame> &frames = *m_frames;
+  if (frames.size () < 2) {
+    return false;
+  }
+  uint64_t bytes = 0;
+  for (uint32_t i = 0; i < frames.size (); i++) {
+    bytes += frames[i].size;
+  }
+  // The last frame lasts as long as the one before it 
+  Time duration = frames.back ().timestamp + frames.back ().timestamp - frames[frames.size () - 2].timestamp;
+  if (!duration.IsStrictlyPositive ()) {
+    return false;
+  }
+  m_scale = bitrate.GetBitRate () / (bytes * 8 / duration.GetSeconds ());
+  return true;
+}
+
+/* ReliableUdpGopFrameSource */
+
+TypeId
+ReliableUdpGopFrameSource::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpGopFrameSource")
+    .SetParent<ReliableUdpFrameSource> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpGopFrameSource> ()
+    .AddAttribute ("Bitrate", "Average bitrate of the stream",
+                   DataRateValue (DataRate ("1Mbps")),
+                   MakeDataRateAccessor (&ReliableUdpGopFrameSource::m_bitrate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("FrameRate", "Frames per second",
+                   DoubleValue (30),
+                   MakeDoubleAccessor (&ReliableUdpGopFrameSource::m_frameRate),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("GopLength", "Number of frames in a GOP",
+                   UintegerValue (30),
+                   MakeUintegerAccessor (&ReliableUdpGopFrameSource::m_gopLength),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BFrames", "Number of B frames between anchor frames",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&ReliableUdpGopFrameSource::m_bFrames),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("IFrameRatio", "Size of an I frame relative to a P frame",
+                   DoubleValue (5),
+                   MakeDoubleAccessor (&ReliableUdpGopFrameSource::m_iRatio),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("BFrameRatio", "Size of a B frame relative to a P frame",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&ReliableUdpGopFrameSource::m_bRatio),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("SizeVariation", "Max relative deviation of a frame size from its average",
+                   DoubleValue (0.2),
+                   MakeDoubleAccessor (&ReliableUdpGopFrameSource::m_variation),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("Random", "Source of the frame size variation",
+                   StringValue ("ns3::UniformRandomVariable[Min=-1.0|Max=1.0]"),
+                   MakePointerAccessor (&ReliableUdpGopFrameSource::m_rng),
+                   MakePointerChecker<UniformRandomVariable> ())
+    ;
+  return tid;
+}
+
+ReliableUdpGopFrameSource::ReliableUdpGopFrameSource ()
+  : m_frameRate (30),
+    m_gopLength (30),
+    m_bFrames (2),
+    m_iRatio (5),
+    m_bRatio (0.5),
+    m_variation (0.2),
+    m_nextId (0)
+{
+}
+
+bool
+ReliableUdpGopFrameSource::SetBitrate (DataRate bitrate)
+{
+  m_bitrate = bitrate;
+  return true;
+}
+
+int64_t
+ReliableUdpGopFrameSource::AssignStreams (int64_t stream)
+{
+  m_rng->SetStream (stream);
+  return 1;
+}
+
+bool
+ReliableUdpGopFrameSource::GetNextFrame (Frame &frame)
+{
+  // Split the GOP budget so that the I:P:B ratios hold 
+  uint32_t nB = 0;
+  for (uint32_t k = 1; k < m_gopLength; k++) {
+    nB += (m_bFrames > 0 && k % (m_bFrames + 1) != 0);
+  }
+  uint32_t nP = m_gopLength - 1 - nB;
+  double gopBytes = m_bitrate.GetBitRate () / 8.0 * m_gopLength / m_frameRate;
+  double pSize = gopBytes / (m_iRatio + nP + m_bRatio * nB);
+
+  uint32_t k = m_nextId % m_gopLength;
+  double size;
+  if (k == 0) {
+    frame.type = I_FRAME;
+    size = m_iRatio * pSize;
+  } else if (m_bFrames > 0 && k % (m_bFrames + 1) != 0) {
+    frame.type = B_FRAME;
+    size = m_bRatio * pSize;
+  } else {
+    frame.type = P_FRAME;
+    size = pSize;
+  }
+  size *= 1 + m_variation * m_rng->GetValue ();
+
+  frame.id = m_nextId++;
+  frame.size = std::max (uint32_t (size), uint32_t (1));
+  frame.timestamp = MicroSeconds (uint64_t (frame.id * 1e6 / m_frameRate));
+  return true;
+}
+
+} // namespace ns3
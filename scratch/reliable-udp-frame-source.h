@@ -0,0 +1,142 @@
+#ifndef RELIABLE_UDP_FRAME_SOURCE_H
+#define RELIABLE_UDP_FRAME_SOURCE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Source of video frames streamed by ReliableUdpServer.
+ *
+ * The server asks for frames one by one and sends each of them at its 
+ * timestamp, fragmented into packets. The implementation is selected by 
+ * the FrameSource attribute of the server.
+ */
+class ReliableUdpFrameSource : public Object
+{
+public:
+  /// Frame types, as carried in ReliableUdpHeader
+  enum FrameType
+  {
+    I_FRAME = 0, //!< Intra-coded frame 
+    P_FRAME = 1, //!< Predicted frame 
+    B_FRAME = 2  //!< Bidirectionally predicted frame 
+  };
+
+  /// A frame to be streamed
+  struct Frame
+  {
+    uint32_t id;      //!< Frame #, starting from 0 
+    uint8_t type;     //!< One of FrameType 
+    uint32_t size;    //!< Encoded size in bytes 
+    Time timestamp;   //!< Presentation time relative to the stream start 
+  };
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual ~ReliableUdpFrameSource ();
+
+  /**
+   * \param frame filled with the next frame
+   * \return false if the stream has ended
+   */
+  virtual bool GetNextFrame (Frame &frame) = 0;
+
+  /**
+   * \brief Switch the encoding bitrate, as an adaptive bitrate controller does.
+   * \param bitrate new average bitrate, applied from the next frame
+   * \return false if the source cannot change its bitrate
+   */
+  virtual bool SetBitrate (DataRate bitrate);
+
+  /**
+   * \brief Assign fixed random variable streams to the random variables of the source.
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned
+   */
+  virtual int64_t AssignStreams (int64_t stream);
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Frames read from a frame-size trace.
+ *
+ * Each line of the trace holds "<timestamp in ms> <I|P|B> <size in bytes>"; 
+ * empty lines and lines starting with '#' are ignored.
+ */
+class ReliableUdpTraceFrameSource : public ReliableUdpFrameSource
+{
+public:
+  static TypeId GetTypeId (void);
+  ReliableUdpTraceFrameSource ();
+
+  virtual bool GetNextFrame (Frame &frame);
+
+  /**
+   * Frame sizes are scaled so that the trace averages out to bitrate.
+   */
+  virtual bool SetBitrate (DataRate bitrate);
+
+private:
+  /**
+   * \brief Point m_frames at the frames of m_traceFile.
+   * A trace is parsed once and shared by every source streaming it, so 
+   * sessions of a multi-client server do not each hold a copy.
+   */
+  void Load (void);
+
+  std::string m_traceFile;      //!< Path of the trace 
+  bool m_loop;                  //!< Whether to restart the trace at its end 
+  const std::vector<Frame> *m_frames; //!< Frames of the trace; 0 until loaded 
+  uint32_t m_next;              //!< Index of the next frame in m_frames 
+  uint32_t m_nextId;            //!< Id of the next frame 
+  Time m_loopOffset;            //!< Timestamp offset of the current loop 
+  double m_scale;               //!< Factor applied to frame sizes 
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Frames synthesized from a GOP model.
+ *
+ * Every GOP starts with an I frame followed by P frames, with BFrames B frames 
+ * between consecutive anchor frames. Frame sizes keep the I:P:B ratios and 
+ * average out to Bitrate at FrameRate, with a uniform variation around them.
+ */
+class ReliableUdpGopFrameSource : public ReliableUdpFrameSource
+{
+public:
+  static TypeId GetTypeId (void);
+  ReliableUdpGopFrameSource ();
+
+  virtual bool GetNextFrame (Frame &frame);
+
+  virtual bool SetBitrate (DataRate bitrate);
+
+  virtual int64_t AssignStreams (int64_t stream);
+
+private:
+  DataRate m_bitrate;         //!< Average bitrate 
+  double m_frameRate;         //!< Frames per second 
+  uint32_t m_gopLength;       //!< Frames per GOP 
+  uint32_t m_bFrames;         //!< B frames between anchor frames 
+  double m_iRatio;            //!< Size of an I frame relative to a P frame 
+  double m_bRatio;            //!< Size of a B frame relative to a P frame 
+  double m_variation;         //!< Max relative deviation of a frame size 
+  Ptr<UniformRandomVariable> m_rng; //!< Source of the size variation 
+  uint32_t m_nextId;          //!< Id of the next frame 
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_FRAME_SOURCE_H */
@@ -6,10 +6,32 @@
 namespace ns3 {
 
 ReliableUdpHeader::ReliableUdpHeader() :
+    m_version(VERSION),
+    m_sections(0),
+    m_streamId(0),
     m_seqNum(0),
     m_ackNum(0),
-    m_signal(0),
-    m_isRetransmit(0)
+    m_sackBitmap(0),
+    m_flags(0),
+    m_windowEdge(0),
+    m_bufferLevel(0),
+    m_isRetransmit(0),
+    m_frameId(0),
+    m_fragIndex(0),
+    m_fragCount(0),
+    m_frameType(0),
+    m_deadline(0),
+    m_forwardSeq(0),
+    m_timestamp(0),
+    m_timestampEcho(0),
+    m_nackBase(0),
+    m_nackBitmap(0),
+    m_nextSeq(0),
+    m_fecMode(0),
+    m_fecBlock(0),
+    m_fecK(0),
+    m_fecM(0),
+    m_fecIndex(0)
 {}
 
 ReliableUdpHeader::~ReliableUdpHeader(){
@@ -34,15 +56,44 @@ void
 ReliableUdpHeader::Print (std::ostream &os) const
 {
   os << "header length: " << GetSerializedSize ()     << " "
-     << "AckNum "<< m_ackNum << "SeqNum" << m_seqNum
-     << "Retransmit" << m_isRetransmit << "Signal" << m_signal
+     << "Version" << (uint32_t) m_version << " "
+     << "Stream" << m_streamId << "AckNum "<< m_ackNum << "SackBitmap" << m_sackBitmap << "SeqNum" << m_seqNum
+     << "Retransmit" << m_isRetransmit << "Flags" << (uint32_t) m_flags << "Window" << m_windowEdge
+     << "BufferLevel" << m_bufferLevel
+     << "Frame" << m_frameId << " " << m_fragIndex << "/" << m_fragCount
+     << "Type" << (uint32_t) m_frameType
+     << "Deadline" << m_deadline << "ForwardSeq" << m_forwardSeq
+     << "Timestamp" << m_timestamp << "Echo" << m_timestampEcho
+     << "Nack" << m_nackBase << " " << m_nackBitmap << "NextSeq" << m_nextSeq
+     << "Fec" << (uint32_t) m_fecMode << " " << m_fecBlock << " " << (uint32_t) m_fecIndex
+     << "/" << (uint32_t) m_fecK << "+" << (uint32_t) m_fecM
   ;
 }
 
 uint32_t
 ReliableUdpHeader::GetSerializedSize (void) const
 {
-  return 18;
+  // Fast path: a data packet of stream 0 has no extensions 
+  if (m_sections == WIRE_DATA && m_streamId == 0 && m_timestampEcho == 0
+      && GetForwardDelta () != 0xffff) {
+    return BASE_SIZE + DATA_SIZE;
+  }
+  uint32_t size = BASE_SIZE;
+  if (m_sections & WIRE_DATA) {
+    size += DATA_SIZE;
+  }
+  if (m_sections & WIRE_ACK) {
+    size += GetVarintSize (m_ackNum) + GetVarintSize (m_windowEdge - m_ackNum)
+      + GetVarintSize (m_bufferLevel);
+  }
+  if (m_sections & WIRE_PARITY) {
+    size += 4 + GetVarintSize (m_fecBlock);
+  }
+  uint32_t ext = GetExtensionsSize ();
+  if (ext > 0) {
+    size += ext + 1;
+  }
+  return size;
 }
 
 void
@@ -50,37 +101,355 @@ ReliableUdpHeader::Serialize (Buffer::Iterator start) const
 {
   Buffer::Iterator i = start;
 
-  i.WriteHtonU32 (m_seqNum);
-  i.WriteHtonU32 (m_ackNum);
-  i.WriteU8 (m_signal);
-  i.WriteU8 (m_isRetransmit);
+  i.WriteU8 ((VERSION << 4) | ((m_frameType & 0x3) << 2));
+  // Fast path: a data packet of stream 0 is written in one go 
+  uint16_t forwardDelta = GetForwardDelta ();
+  if (m_sections == WIRE_DATA && m_streamId == 0 && m_timestampEcho == 0
+      && forwardDelta != 0xffff) {
+    i.WriteU8 (m_flags | WIRE_DATA | (m_isRetransmit ? WIRE_RETRANSMIT : 0));
+    i.WriteHtonU32 (m_seqNum);
+    i.WriteHtonU16 (m_frameId);
+    i.WriteHtonU16 (m_fragIndex);
+    i.WriteHtonU16 (m_fragCount);
+    i.WriteHtonU32 (m_deadline);
+    i.WriteHtonU16 (forwardDelta);
+    i.WriteHtonU32 (m_timestamp);
+    return;
+  }
+
+  bool ext = GetExtensionsSize () > 0;
+  i.WriteU8 (GetWireFlags () | (ext ? WIRE_EXT : 0));
+  if (m_sections & WIRE_DATA) {
+    i.WriteHtonU32 (m_seqNum);
+    i.WriteHtonU16 (m_frameId);
+    i.WriteHtonU16 (m_fragIndex);
+    i.WriteHtonU16 (m_fragCount);
+    i.WriteHtonU32 (m_deadline);
+    i.WriteHtonU16 (forwardDelta);
+    i.WriteHtonU32 (m_timestamp);
+  }
+  if (m_sections & WIRE_ACK) {
+    WriteVarint (i, m_ackNum);
+    WriteVarint (i, m_windowEdge - m_ackNum);
+    WriteVarint (i, m_bufferLevel);
+  }
+  if (m_sections & WIRE_PARITY) {
+    i.WriteU8 (m_fecMode);
+    WriteVarint (i, m_fecBlock);
+    i.WriteU8 (m_fecK);
+    i.WriteU8 (m_fecM);
+    i.WriteU8 (m_fecIndex);
+  }
+  if (!ext) {
+    return;
+  }
+  if (m_streamId != 0) {
+    i.WriteU8 (EXT_STREAM_ID);
+    i.WriteU8 (GetVarintSize (m_streamId));
+    WriteVarint (i, m_streamId);
+  }
+  if ((m_sections & WIRE_ACK) && m_sackBitmap != 0) {
+    uint32_t ranges[32];
+    uint32_t n = GetSackRanges (ranges);
+    uint32_t length = 0;
+    for (uint32_t k = 0; k < n; k++) {
+      length += GetVarintSize (ranges[k]);
+    }
+    i.WriteU8 (EXT_SACK_RANGES);
+    i.WriteU8 (length);
+    for (uint32_t k = 0; k < n; k++) {
+      WriteVarint (i, ranges[k]);
+    }
+  }
+  if (!(m_sections & WIRE_DATA) && m_timestamp != 0) {
+    i.WriteU8 (EXT_TIMESTAMP);
+    i.WriteU8 (4);
+    i.WriteHtonU32 (m_timestamp);
+  }
+  if (m_timestampEcho != 0) {
+    i.WriteU8 (EXT_TIMESTAMP_ECHO);
+    i.WriteU8 (4);
+    i.WriteHtonU32 (m_timestampEcho);
+  }
+  if (forwardDelta == 0xffff && m_forwardSeq != 0) {
+    i.WriteU8 (EXT_FORWARD_SEQ);
+    i.WriteU8 (GetVarintSize (m_forwardSeq));
+    WriteVarint (i, m_forwardSeq);
+  }
+  if ((m_sections & WIRE_ACK) && m_nackBitmap != 0) {
+    uint32_t bytes = GetNackBitmapSize ();
+    i.WriteU8 (EXT_NACK);
+    i.WriteU8 (GetVarintSize (m_nackBase - m_ackNum) + bytes);
+    WriteVarint (i, m_nackBase - m_ackNum);
+    for (uint32_t k = 0; k < bytes; k++) {
+      i.WriteU8 (uint8_t (m_nackBitmap >> (8 * k)));
+    }
+  }
+  if (m_flags & FLAG_KEEPALIVE) {
+    i.WriteU8 (EXT_NEXT_SEQ);
+    i.WriteU8 (GetVarintSize (m_nextSeq));
+    WriteVarint (i, m_nextSeq);
+  }
+  i.WriteU8 (EXT_END);
 }
 
 uint32_t
 ReliableUdpHeader::Deserialize (Buffer::Iterator start)
 {
   Buffer::Iterator i = start;
-  m_seqNum = i.ReadU32 ();
-  m_ackNum = i.ReadU32 ();
-  m_signal = i.ReadU8 ();
-  m_isRetransmit = i.ReadU8 ();
+  // Fields absent from the packet read as zero 
+  *this = ReliableUdpHeader ();
+  uint8_t first = i.ReadU8 ();
+  m_version = first >> 4;
+  if (m_version != VERSION) {
+    // The rest cannot be interpreted; the receiver drops the packet 
+    return 1;
+  }
+  m_frameType = (first >> 2) & 0x3;
+  uint8_t flags = i.ReadU8 ();
+  m_flags = flags & (FLAG_PROBE | FLAG_HELLO | FLAG_KEEPALIVE);
+  m_isRetransmit = (flags & WIRE_RETRANSMIT) != 0;
+  m_sections = flags & (WIRE_DATA | WIRE_ACK | WIRE_PARITY);
+
+  uint16_t forwardDelta = 0xffff;
+  if (flags & WIRE_DATA) {
+    m_seqNum = i.ReadNtohU32 ();
+    m_frameId = i.ReadNtohU16 ();
+    m_fragIndex = i.ReadNtohU16 ();
+    m_fragCount = i.ReadNtohU16 ();
+    m_deadline = i.ReadNtohU32 ();
+    forwardDelta = i.ReadNtohU16 ();
+    m_timestamp = i.ReadNtohU32 ();
+    m_forwardSeq = forwardDelta != 0xffff ? m_seqNum - forwardDelta : 0;
+  }
+  if (flags & WIRE_ACK) {
+    m_ackNum = ReadVarint (i);
+    m_windowEdge = m_ackNum + ReadVarint (i);
+    m_bufferLevel = ReadVarint (i);
+  }
+  if (flags & WIRE_PARITY) {
+    m_fecMode = i.ReadU8 ();
+    m_fecBlock = ReadVarint (i);
+    m_fecK = i.ReadU8 ();
+    m_fecM = i.ReadU8 ();
+    m_fecIndex = i.ReadU8 ();
+  }
+  if (flags & WIRE_EXT) {
+    uint8_t type;
+    while ((type = i.ReadU8 ()) != EXT_END) {
+      uint8_t length = i.ReadU8 ();
+      Buffer::Iterator value = i;
+      i.Next (length);
+      switch (type) {
+        case EXT_STREAM_ID:
+          m_streamId = ReadVarint (value);
+          break;
+        case EXT_SACK_RANGES:
+          {
+            // Ranges are relative to the end of the previous one, the 
+            // first to ackNum + 1 
+            uint32_t bit = 0;
+            uint32_t consumed = 0;
+            while (consumed < length) {
+              uint32_t gap = ReadVarint (value);
+              uint32_t run = ReadVarint (value);
+              consumed += GetVarintSize (gap) + GetVarintSize (run);
+              bit += gap;
+              for (uint32_t k = 0; k < run && bit < 32; k++, bit++) {
+                m_sackBitmap |= 1u << bit;
+              }
+            }
+          }
+          break;
+        case EXT_TIMESTAMP:
+          m_timestamp = value.ReadNtohU32 ();
+          break;
+        case EXT_TIMESTAMP_ECHO:
+          m_timestampEcho = value.ReadNtohU32 ();
+          break;
+        case EXT_FORWARD_SEQ:
+          m_forwardSeq = ReadVarint (value);
+          break;
+        case EXT_NACK:
+          {
+            uint32_t offset = ReadVarint (value);
+            m_nackBase = m_ackNum + offset;
+            for (uint32_t k = 0; k + GetVarintSize (offset) < length && k < 8; k++) {
+              m_nackBitmap |= uint64_t (value.ReadU8 ()) << (8 * k);
+            }
+          }
+          break;
+        case EXT_NEXT_SEQ:
+          m_nextSeq = ReadVarint (value);
+          break;
+        default:
+          // Written by a newer version; its length lets us skip it 
+          break;
+      }
+    }
+  }
+  return i.GetDistanceFrom (start);
+}
+
+uint8_t
+ReliableUdpHeader::GetWireFlags (void) const
+{
+  return m_flags | m_sections | (m_isRetransmit ? WIRE_RETRANSMIT : 0);
+}
+
+uint16_t
+ReliableUdpHeader::GetForwardDelta (void) const
+{
+  uint32_t delta = m_seqNum - m_forwardSeq;
+  if (!(m_sections & WIRE_DATA) || int32_t (delta) < 0 || delta >= 0xffff) {
+    return 0xffff;
+  }
+  return delta;
+}
+
+uint32_t
+ReliableUdpHeader::GetExtensionsSize (void) const
+{
+  uint32_t size = 0;
+  if (m_streamId != 0) {
+    size += 2 + GetVarintSize (m_streamId);
+  }
+  if ((m_sections & WIRE_ACK) && m_sackBitmap != 0) {
+    uint32_t ranges[32];
+    uint32_t n = GetSackRanges (ranges);
+    size += 2;
+    for (uint32_t k = 0; k < n; k++) {
+      size += GetVarintSize (ranges[k]);
+    }
+  }
+  if (!(m_sections & WIRE_DATA) && m_timestamp != 0) {
+    size += 6;
+  }
+  if (m_timestampEcho != 0) {
+    size += 6;
+  }
+  if (GetForwardDelta () == 0xffff && m_forwardSeq != 0) {
+    size += 2 + GetVarintSize (m_forwardSeq);
+  }
+  if ((m_sections & WIRE_ACK) && m_nackBitmap != 0) {
+    size += 2 + GetVarintSize (m_nackBase - m_ackNum) + GetNackBitmapSize ();
+  }
+  if (m_flags & FLAG_KEEPALIVE) {
+    size += 2 + GetVarintSize (m_nextSeq);
+  }
+  return size;
+}
+
+uint32_t
+ReliableUdpHeader::GetVarintSize (uint32_t value)
+{
+  uint32_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+void
+ReliableUdpHeader::WriteVarint (Buffer::Iterator &i, uint32_t value)
+{
+  while (value >= 0x80) {
+    i.WriteU8 ((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  i.WriteU8 (value);
+}
+
+uint32_t
+ReliableUdpHeader::ReadVarint (Buffer::Iterator &i)
+{
+  uint32_t value = 0;
+  for (uint32_t shift = 0; shift < 35; shift += 7) {
+    uint8_t byte = i.ReadU8 ();
+    value |= uint32_t (byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+  return value;
+}
+
+uint32_t
+ReliableUdpHeader::GetSackRanges (uint32_t ranges[32]) const
+{
+  uint32_t n = 0;
+  uint32_t end = 0;
+  uint32_t bit = 0;
+  while (bit < 32) {
+    if (!(m_sackBitmap & (1u << bit))) {
+      bit++;
+      continue;
+    }
+    uint32_t first = bit;
+    while (bit < 32 && (m_sackBitmap & (1u << bit))) {
+      bit++;
+    }
+    ranges[n++] = first - end;
+    ranges[n++] = bit - first;
+    end = bit;
+  }
+  return n;
+}
+
+uint32_t
+ReliableUdpHeader::GetNackBitmapSize (void) const
+{
+  uint32_t bytes = 0;
+  for (uint64_t bitmap = m_nackBitmap; bitmap != 0; bitmap >>= 8) {
+    bytes++;
+  }
+  return bytes;
+}
 
-  return GetSerializedSize ();
+uint8_t 
+ReliableUdpHeader::GetVersion (){
+  return m_version;
+}
+
+void 
+ReliableUdpHeader::SetStreamId (uint16_t streamId){
+  m_streamId = streamId;
 }
 
 void 
 ReliableUdpHeader::SetSeqNum (uint32_t seqNum){
+  m_sections |= WIRE_DATA;
   m_seqNum = seqNum;
 }
 
 void 
 ReliableUdpHeader::SetAckNum (uint32_t ackNum){
+  m_sections |= WIRE_ACK;
   m_ackNum = ackNum;
 }
 
 void 
-ReliableUdpHeader::SetSignal (uint8_t signal){
-  m_signal = signal;
+ReliableUdpHeader::SetSackBitmap (uint32_t sackBitmap){
+  m_sections |= WIRE_ACK;
+  m_sackBitmap = sackBitmap;
+}
+
+void 
+ReliableUdpHeader::SetFlags (uint8_t flags){
+  m_flags = flags;
+}
+
+void 
+ReliableUdpHeader::SetWindowEdge (uint32_t windowEdge){
+  m_sections |= WIRE_ACK;
+  m_windowEdge = windowEdge;
+}
+
+void 
+ReliableUdpHeader::SetBufferLevel (Time bufferLevel){
+  m_sections |= WIRE_ACK;
+  m_bufferLevel = bufferLevel.GetMilliSeconds ();
 }
 
 void 
@@ -88,6 +457,73 @@ ReliableUdpHeader::SetRetransmit (uint8_t isRetransmit){
   m_isRetransmit = isRetransmit;
 }
 
+void 
+ReliableUdpHeader::SetFrameId (uint32_t frameId){
+  m_sections |= WIRE_DATA;
+  m_frameId = frameId;
+}
+
+void 
+ReliableUdpHeader::SetFragment (uint16_t fragIndex, uint16_t fragCount){
+  m_sections |= WIRE_DATA;
+  m_fragIndex = fragIndex;
+  m_fragCount = fragCount;
+}
+
+void 
+ReliableUdpHeader::SetFrameType (uint8_t frameType){
+  m_sections |= WIRE_DATA;
+  m_frameType = frameType;
+}
+
+void 
+ReliableUdpHeader::SetDeadline (Time deadline){
+  m_sections |= WIRE_DATA;
+  m_deadline = deadline.GetMilliSeconds ();
+}
+
+void 
+ReliableUdpHeader::SetForwardSeq (uint32_t forwardSeq){
+  m_forwardSeq = forwardSeq;
+}
+
+void 
+ReliableUdpHeader::SetTimestamp (uint32_t timestamp){
+  m_timestamp = timestamp;
+}
+
+void 
+ReliableUdpHeader::SetTimestampEcho (uint32_t timestampEcho){
+  m_timestampEcho = timestampEcho;
+}
+
+void 
+ReliableUdpHeader::SetNack (uint32_t base, uint64_t bitmap){
+  m_sections |= WIRE_ACK;
+  m_nackBase = base;
+  m_nackBitmap = bitmap;
+}
+
+void 
+ReliableUdpHeader::SetNextSeq (uint32_t nextSeq){
+  m_nextSeq = nextSeq;
+}
+
+void 
+ReliableUdpHeader::SetFec (uint8_t mode, uint32_t block, uint8_t k, uint8_t m, uint8_t index){
+  m_sections |= WIRE_PARITY;
+  m_fecMode = mode;
+  m_fecBlock = block;
+  m_fecK = k;
+  m_fecM = m;
+  m_fecIndex = index;
+}
+
+uint16_t 
+ReliableUdpHeader::GetStreamId (){
+  return m_streamId;
+}
+
 uint32_t 
 ReliableUdpHeader::GetSeqNum (){
   return m_seqNum;
@@ -98,9 +534,24 @@ ReliableUdpHeader::GetAckNum (){
   return m_ackNum;
 }
 
+uint32_t 
+ReliableUdpHeader::GetSackBitmap (){
+  return m_sackBitmap;
+}
+
 uint8_t 
-ReliableUdpHeader::GetSignal (){
-  return m_signal;
+ReliableUdpHeader::GetFlags (){
+  return m_flags;
+}
+
+uint32_t 
+ReliableUdpHeader::GetWindowEdge (){
+  return m_windowEdge;
+}
+
+Time 
+ReliableUdpHeader::GetBufferLevel (){
+  return MilliSeconds (m_bufferLevel);
 }
 
 uint8_t 
@@ -108,5 +559,89 @@ ReliableUdpHeader::GetRetransmit (){
   return m_isRetransmit;
 }
 
+uint32_t 
+ReliableUdpHeader::GetFrameId (){
+  return m_frameId;
+}
+
+uint16_t 
+ReliableUdpHeader::GetFragIndex (){
+  return m_fragIndex;
+}
+
+uint16_t 
+ReliableUdpHeader::GetFragCount (){
+  return m_fragCount;
+}
+
+uint8_t 
+ReliableUdpHeader::GetFrameType (){
+  return m_frameType;
+}
+
+Time 
+ReliableUdpHeader::GetDeadline (){
+  return MilliSeconds (m_deadline);
+}
+
+uint32_t 
+ReliableUdpHeader::GetForwardSeq (){
+  return m_forwardSeq;
 }
 
+uint32_t 
+ReliableUdpHeader::GetTimestamp (){
+  return m_timestamp;
+}
+
+uint32_t 
+ReliableUdpHeader::GetTimestampEcho (){
+  return m_timestampEcho;
+}
+
+uint32_t 
+ReliableUdpHeader::GetNackBase (){
+  return m_nackBase;
+}
+
+uint64_t 
+ReliableUdpHeader::GetNackBitmap (){
+  return m_nackBitmap;
+}
+
+uint32_t 
+ReliableUdpHeader::GetNextSeq (){
+  return m_nextSeq;
+}
+
+bool 
+ReliableUdpHeader::IsParity (){
+  return m_fecMode != 0;
+}
+
+uint8_t 
+ReliableUdpHeader::GetFecMode (){
+  return m_fecMode;
+}
+
+uint32_t 
+ReliableUdpHeader::GetFecBlock (){
+  return m_fecBlock;
+}
+
+uint8_t 
+ReliableUdpHeader::GetFecK (){
+  return m_fecK;
+}
+
+uint8_t 
+ReliableUdpHeader::GetFecM (){
+  return m_fecM;
+}
+
+uint8_t 
+ReliableUdpHeader::GetFecIndex (){
+  return m_fecIndex;
+}
+
+}
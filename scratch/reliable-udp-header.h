@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <string>
 #include "ns3/header.h"
+#include "ns3/nstime.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
 
@@ -11,6 +12,25 @@ namespace ns3 {
 /**
  * \ingroup reliableudp
  * \brief Packet header for reliable UDP packets
+ *
+ * The wire format is versioned and carries only the sections a packet uses:
+ *
+ * - 1 byte: version (4 bits), frame type (2 bits), reserved (2 bits)
+ * - 1 byte: flags; PROBE, HELLO, KEEPALIVE and RETRANSMIT signal, DATA, 
+ *   ACK and PARITY tell which sections follow, EXT that extensions follow
+ * - DATA, 20 bytes: seq # (32), frame # (low 16), fragment index (16), 
+ *   fragment count (16), deadline in ms (32), seq # minus forward seq # 
+ *   (16; 0xffff if it does not fit), timestamp (32)
+ * - ACK: ack #, window edge minus ack # and buffer level in ms, as varints
+ * - PARITY: FEC mode (8), block as a varint, K (8), M (8), index (8)
+ * - EXT: TLV extensions (type, length, value) ended by a zero type byte: 
+ *   stream id, SACK ranges, timestamp and forward seq # of packets 
+ *   without DATA, timestamp echo, NACK (base as a varint relative to the 
+ *   ack #, then the bitmap in as few little-endian bytes as it needs), 
+ *   next seq # of a keepalive. Unknown types are skipped.
+ *
+ * Varints are LEB128. A data packet of stream 0, the common case, is a 
+ * fixed 22 bytes and takes a fast path through serialization.
  */
 class ReliableUdpHeader : public Header 
 {
@@ -24,32 +44,197 @@ public:
   ReliableUdpHeader ();
   ~ReliableUdpHeader ();
 
+  /**
+   * \param streamId Stream the packet belongs to. Every stream has its own 
+   * sequence space, so seq, ack, window and FEC fields refer to it.
+   */
+  void SetStreamId (uint16_t streamId);
+
   /**
    * \param seqNum A sequence number that server sends to client 
    */
   void SetSeqNum (uint32_t seqNum);
 
   /**
-   * \param ackNum An acknowledge number that client sends to server 
+   * \param ackNum A cumulative acknowledge number that client sends to server.
+   * Every packet whose sequence # is lower than ackNum was received.
    */
   void SetAckNum (uint32_t ackNum);
 
   /**
-   * \param signal Signal that client send to server to stop/resume sending.
-   * ex) 0x00 for NO_SIGNAL, 0x01 for STOP, 0x02 for RESUME 
+   * \param sackBitmap Selective acknowledgement of the packets beyond ackNum.
+   * Bit i is set when the packet with sequence # (ackNum + 1 + i) was received.
+   */
+  void SetSackBitmap (uint32_t sackBitmap);
+
+  /// Version of the wire format written by Serialize()
+  static const uint8_t VERSION = 1;
+
+  /// Largest header of a data packet: version, flags, DATA, and the 
+  /// stream id extension (2 + 20 + 2 + 3 + 1 bytes)
+  static const uint32_t MAX_DATA_HEADER_SIZE = 28;
+
+  /// Flags of the flags byte
+  enum Flags
+  {
+    FLAG_PROBE = 0x01,  //!< Zero window probe; the client answers with an ack 
+    FLAG_HELLO = 0x02,  //!< Sent by a client to open a session; by the server to a client it has no session for 
+    FLAG_KEEPALIVE = 0x80 //!< Sent by the server when idle in NACK_MODE; carries the next seq # 
+  };
+
+  /// How losses are found; client and server must use the same mode
+  enum ReliabilityMode
+  {
+    ACK_MODE = 0, //!< The client acks every few packets; the server infers losses from SACKs and RTO timers 
+    NACK_MODE = 1 //!< The client acks periodically and NACKs the gaps it sees; the server resends what is NACKed 
+  };
+
+  /**
+   * \return version of the wire format the header was read in; packets of 
+   * another version than VERSION cannot be interpreted and should be dropped
+   */
+  uint8_t GetVersion ();
+
+  /**
+   * \param flags OR of Flags
    */
-  void SetSignal (uint8_t signal);
+  void SetFlags (uint8_t flags);
+
+  /**
+   * \param windowEdge Advertised receive window of the client: the server 
+   * may send packets whose sequence # is below it.
+   */
+  void SetWindowEdge (uint32_t windowEdge);
+
+  /**
+   * \param bufferLevel Play time buffered by the client, reported in acks 
+   * for bitrate adaptation. Carried with millisecond resolution.
+   */
+  void SetBufferLevel (Time bufferLevel);
 
   void SetRetransmit (uint8_t isRetransmit);
 
+  /**
+   * \brief Ask the server to resend missing packets, in NACK_MODE.
+   * It goes with the ACK section; base should not be below the ack #.
+   * \param base sequence # of the first packet asked for
+   * \param bitmap bit i is set when the packet with sequence # (base + i) 
+   * is asked for; zero for no NACK
+   */
+  void SetNack (uint32_t base, uint64_t bitmap);
+
+  /**
+   * \param nextSeq Sequence # of the next new packet of the stream, carried 
+   * by keepalives so that the client can tell losses at the tail of a burst
+   */
+  void SetNextSeq (uint32_t nextSeq);
+
+  /**
+   * \param frameId Number of the video frame the packet belongs to. Only 
+   * its low 16 bits are carried; they tell frames apart within a window.
+   */
+  void SetFrameId (uint32_t frameId);
+
+  /**
+   * \param fragIndex Position of the packet among the fragments of its frame
+   * \param fragCount Number of fragments of the frame
+   */
+  void SetFragment (uint16_t fragIndex, uint16_t fragCount);
+
+  /**
+   * \param frameType Type of the frame, one of ReliableUdpFrameSource::FrameType
+   */
+  void SetFrameType (uint8_t frameType);
+
+  /**
+   * \param deadline Presentation deadline of the packet; it is useless to 
+   * the client after it. Carried with millisecond resolution; zero for none.
+   */
+  void SetDeadline (Time deadline);
+
+  /**
+   * \param forwardSeq Every sequence # below it was either acked or abandoned
+   * by the server, so the client should not wait for missing ones.
+   */
+  void SetForwardSeq (uint32_t forwardSeq);
+
+  /**
+   * \param timestamp Send time of the packet in microseconds, wrapping 
+   * around; zero for none. Set by the server on every transmission.
+   */
+  void SetTimestamp (uint32_t timestamp);
+
+  /**
+   * \param timestampEcho Timestamp of the latest packet the client received 
+   * that was not a retransmission, echoed in acks so that the server can 
+   * measure the RTT; zero for none.
+   */
+  void SetTimestampEcho (uint32_t timestampEcho);
+
+  /**
+   * \brief Mark the packet as a FEC parity packet. Parity packets are 
+   * outside the sequence space and never acked or retransmitted.
+   * \param mode ReliableUdpFec::Mode of the block
+   * \param block sequence # of the first data packet of the block
+   * \param k number of data packets in the block
+   * \param m number of parity packets in the block
+   * \param index position of this parity packet in the block
+   */
+  void SetFec (uint8_t mode, uint32_t block, uint8_t k, uint8_t m, uint8_t index);
+
+  uint16_t GetStreamId ();
+
   uint32_t GetSeqNum ();
 
   uint32_t GetAckNum ();
 
-  uint8_t GetSignal ();
+  uint32_t GetSackBitmap ();
+
+  uint8_t GetFlags ();
+
+  uint32_t GetWindowEdge ();
+
+  Time GetBufferLevel ();
 
   uint8_t GetRetransmit ();
 
+  uint32_t GetFrameId ();
+
+  uint16_t GetFragIndex ();
+
+  uint16_t GetFragCount ();
+
+  uint8_t GetFrameType ();
+
+  Time GetDeadline ();
+
+  uint32_t GetForwardSeq ();
+
+  uint32_t GetTimestamp ();
+
+  uint32_t GetTimestampEcho ();
+
+  uint32_t GetNackBase ();
+
+  uint64_t GetNackBitmap ();
+
+  uint32_t GetNextSeq ();
+
+  /**
+   * \return whether the packet carries FEC parity instead of data
+   */
+  bool IsParity ();
+
+  uint8_t GetFecMode ();
+
+  uint32_t GetFecBlock ();
+
+  uint8_t GetFecK ();
+
+  uint8_t GetFecM ();
+
+  uint8_t GetFecIndex ();
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -62,10 +247,105 @@ public:
   virtual uint32_t Deserialize (Buffer::Iterator start);
 
 private:
+  /// Bits of the flags byte set by the header itself
+  enum WireFlags
+  {
+    WIRE_RETRANSMIT = 0x04, //!< Retransmitted data 
+    WIRE_DATA = 0x08,       //!< DATA section follows 
+    WIRE_ACK = 0x10,        //!< ACK section follows 
+    WIRE_PARITY = 0x20,     //!< PARITY section follows 
+    WIRE_EXT = 0x40         //!< TLV extensions follow 
+  };
+
+  /// Types of TLV extensions
+  enum ExtensionType
+  {
+    EXT_END = 0,            //!< End of the extensions 
+    EXT_STREAM_ID = 1,      //!< Stream id, varint 
+    EXT_SACK_RANGES = 2,    //!< Pairs of varints: gap from the previous range end, range length 
+    EXT_TIMESTAMP = 3,      //!< Timestamp of a packet without DATA, 32 bits 
+    EXT_TIMESTAMP_ECHO = 4, //!< Echoed timestamp, 32 bits 
+    EXT_FORWARD_SEQ = 5,    //!< Forward seq # not carried by DATA, varint 
+    EXT_NACK = 6,           //!< NACK base minus ack #, varint, and bitmap bytes 
+    EXT_NEXT_SEQ = 7        //!< Next seq # of a keepalive, varint 
+  };
+
+  /// Size of the version and flags bytes
+  static const uint32_t BASE_SIZE = 2;
+  /// Size of the DATA section
+  static const uint32_t DATA_SIZE = 20;
+
+  /**
+   * \return the flags byte to write
+   */
+  uint8_t GetWireFlags (void) const;
+
+  /**
+   * \return the seq # minus forward seq # field of DATA; 0xffff if the 
+   * forward seq # goes in an extension instead
+   */
+  uint16_t GetForwardDelta (void) const;
+
+  /**
+   * \return size of the TLV extensions without the end byte; 0 if none
+   */
+  uint32_t GetExtensionsSize (void) const;
+
+  /**
+   * \param value a value
+   * \return bytes taken by value as a varint
+   */
+  static uint32_t GetVarintSize (uint32_t value);
+
+  /**
+   * \param i where to write
+   * \param value the value to write as a varint
+   */
+  static void WriteVarint (Buffer::Iterator &i, uint32_t value);
+
+  /**
+   * \param i where to read
+   * \return the varint read
+   */
+  static uint32_t ReadVarint (Buffer::Iterator &i);
+
+  /**
+   * \param ranges filled with (gap, length) pairs covering m_sackBitmap
+   * \return number of values in ranges
+   */
+  uint32_t GetSackRanges (uint32_t ranges[32]) const;
+
+  /**
+   * \return bytes of the NACK bitmap on the wire
+   */
+  uint32_t GetNackBitmapSize (void) const;
+
+  uint8_t m_version;    //!< Version the header was read in 
+  uint8_t m_sections;   //!< WIRE_DATA, WIRE_ACK and WIRE_PARITY bits of the sections set 
+  uint16_t m_streamId;  //!< Stream # 
   uint32_t m_seqNum;    //!< Sequence #
-  uint32_t m_ackNum;    //!< Ack #
-  uint8_t m_signal;     //!< Signal to stop/resume sending 
+  uint32_t m_ackNum;    //!< Cumulative ack #
+  uint32_t m_sackBitmap; //!< Selective acks of packets following m_ackNum
+  uint8_t m_flags;      //!< OR of Flags 
+  uint32_t m_windowEdge; //!< Seq # the server may send up to, exclusive 
+  uint32_t m_bufferLevel; //!< Play time buffered by the client in ms 
   uint8_t m_isRetransmit; //!< Indicates wheter retransmit or not 
+  uint32_t m_frameId;   //!< Frame # 
+  uint16_t m_fragIndex; //!< Fragment # within the frame 
+  uint16_t m_fragCount; //!< Fragments in the frame 
+  uint8_t m_frameType;  //!< I/P/B 
+  uint32_t m_deadline;  //!< Presentation deadline in ms 
+  uint32_t m_forwardSeq; //!< Seq # below which the client may skip gaps 
+  uint32_t m_timestamp; //!< Send time in us 
+  uint32_t m_timestampEcho; //!< Echoed send time in us 
+  uint32_t m_nackBase;  //!< First seq # of the NACK bitmap 
+  uint64_t m_nackBitmap; //!< Packets the client asks for; zero for no NACK 
+  uint32_t m_nextSeq;   //!< Next seq # announced by a keepalive 
+  uint8_t m_fecMode;    //!< FEC mode of a parity packet; 0 for data 
+  uint32_t m_fecBlock;  //!< First seq # of the FEC block 
+  uint8_t m_fecK;       //!< Data packets in the FEC block 
+  uint8_t m_fecM;       //!< Parity packets in the FEC block 
+  uint8_t m_fecIndex;   //!< Index of the parity packet in the FEC block 
 };
 
 } // namespace ns3
@@ -0,0 +1,162 @@
+#include "ns3/assert.h"
+#include "reliable-udp-reorder-buffer.h"
+
+namespace ns3 {
+
+ReliableUdpReorderBuffer::ReliableUdpReorderBuffer ()
+  : m_nextExpected (0),
+    m_nPackets (0)
+{
+  SetCapacity (1024);
+}
+
+void
+ReliableUdpReorderBuffer::SetCapacity (uint32_t capacity)
+{
+  NS_ASSERT (capacity > 0);
+  m_slots.assign (capacity, 0);
+  m_occupied.assign ((capacity + 63) / 64, 0);
+  m_skipped.assign ((capacity + 63) / 64, 0);
+  m_nPackets = 0;
+}
+
+uint32_t
+ReliableUdpReorderBuffer::GetCapacity (void) const
+{
+  return m_slots.size ();
+}
+
+ReliableUdpReorderBuffer::InsertResult
+ReliableUdpReorderBuffer::Insert (uint32_t seq, Ptr<Packet> packet)
+{
+  uint32_t slot = seq % GetCapacity ();
+  if (int32_t (seq - m_nextExpected) < 0) {
+    // Behind the window; a skipped one is known only while its slot 
+    // has not been reused 
+    bool skipped = m_nextExpected - seq <= GetCapacity () && IsBitSet (m_skipped, slot);
+    return skipped ? SKIPPED : DUPLICATE;
+  }
+  if (seq - m_nextExpected >= GetCapacity ()) {
+    return OUT_OF_WINDOW;
+  }
+  if (IsSet (slot)) {
+    return DUPLICATE;
+  }
+  m_slots[slot] = packet;
+  Set (slot);
+  ClearBit (m_skipped, slot);
+  m_nPackets++;
+  return INSERTED;
+}
+
+Ptr<Packet>
+ReliableUdpReorderBuffer::PopInOrder (void)
+{
+  uint32_t slot = m_nextExpected % GetCapacity ();
+  if (!IsSet (slot)) {
+    return 0;
+  }
+  Ptr<Packet> p = m_slots[slot];
+  m_slots[slot] = 0;
+  Clear (slot);
+  ClearBit (m_skipped, slot);
+  m_nPackets--;
+  m_nextExpected++;
+  return p;
+}
+
+void
+ReliableUdpReorderBuffer::SkipNext (void)
+{
+  NS_ASSERT (!IsSet (m_nextExpected % GetCapacity ()));
+  SetBit (m_skipped, m_nextExpected % GetCapacity ());
+  m_nextExpected++;
+}
+
+Ptr<Packet>
+ReliableUdpReorderBuffer::PeekFirst (uint32_t *seq) const
+{
+  if (m_nPackets == 0) {
+    return 0;
+  }
+  for (uint32_t s = m_nextExpected; ; s++) {
+    if (IsSet (s % GetCapacity ())) {
+      *seq = s;
+      return m_slots[s % GetCapacity ()];
+    }
+  }
+}
+
+uint32_t
+ReliableUdpReorderBuffer::GetNextExpected (void) const
+{
+  return m_nextExpected;
+}
+
+uint32_t
+ReliableUdpReorderBuffer::GetSackBitmap (void) const
+{
+  uint32_t bitmap = 0;
+  if (m_nPackets == 0) {
+    return bitmap;
+  }
+  for (uint32_t i = 0; i < 32 && i + 1 < GetCapacity (); i++) {
+    if (IsSet ((m_nextExpected + 1 + i) % GetCapacity ())) {
+      bitmap |= 1u << i;
+    }
+  }
+  return bitmap;
+}
+
+bool
+ReliableUdpReorderBuffer::IsReceived (uint32_t seq) const
+{
+  if (int32_t (seq - m_nextExpected) < 0) {
+    return true;
+  }
+  return seq - m_nextExpected < GetCapacity () && IsSet (seq % GetCapacity ());
+}
+
+uint32_t
+ReliableUdpReorderBuffer::GetNPackets (void) const
+{
+  return m_nPackets;
+}
+
+bool
+ReliableUdpReorderBuffer::IsSet (uint32_t slot) const
+{
+  return IsBitSet (m_occupied, slot);
+}
+
+void
+ReliableUdpReorderBuffer::Set (uint32_t slot)
+{
+  SetBit (m_occupied, slot);
+}
+
+void
+ReliableUdpReorderBuffer::Clear (uint32_t slot)
+{
+  ClearBit (m_occupied, slot);
+}
+
+bool
+ReliableUdpReorderBuffer::IsBitSet (const std::vector<uint64_t> &bitmap, uint32_t slot)
+{
+  return (bitmap[slot / 64] >> (slot % 64)) & 1;
+}
+
+void
+ReliableUdpReorderBuffer::SetBit (std::vector<uint64_t> &bitmap, uint32_t slot)
+{
+  bitmap[slot / 64] |= uint64_t (1) << (slot % 64);
+}
+
+void
+ReliableUdpReorderBuffer::ClearBit (std::vector<uint64_t> &bitmap, uint32_t slot)
+{
+  bitmap[slot / 64] &= ~(uint64_t (1) << (slot % 64));
+}
+
+} // namespace ns3
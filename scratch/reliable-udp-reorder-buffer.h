@@ -0,0 +1,110 @@
+#ifndef RELIABLE_UDP_REORDER_BUFFER_H
+#define RELIABLE_UDP_REORDER_BUFFER_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup reliableudpclient
+ * \brief Fixed-capacity reorder window of received packets.
+ *
+ * Packets are stored at slot (seq % capacity), so inserting, checking for 
+ * duplicates and popping the next in-order packet are all O(1). A bitmap 
+ * tracks which slots are occupied. Only sequence #s in 
+ * [nextExpected, nextExpected + capacity) can be stored.
+ */
+class ReliableUdpReorderBuffer
+{
+public:
+  /// Result of an insertion
+  enum InsertResult
+  {
+    INSERTED,     //!< Packet stored 
+    DUPLICATE,    //!< Packet was already received 
+    OUT_OF_WINDOW, //!< Packet is too far ahead of the next expected one 
+    SKIPPED       //!< Packet arrived after SkipNext() gave up on it 
+  };
+
+  ReliableUdpReorderBuffer ();
+
+  /**
+   * \brief Resize the window. Stored packets are discarded.
+   * \param capacity number of packets the window can hold
+   */
+  void SetCapacity (uint32_t capacity);
+
+  uint32_t GetCapacity (void) const;
+
+  /**
+   * \param seq sequence # of the packet
+   * \param packet the packet, including its ReliableUdpHeader
+   * \return whether the packet was stored
+   */
+  InsertResult Insert (uint32_t seq, Ptr<Packet> packet);
+
+  /**
+   * \brief Remove the next in-order packet.
+   * \return the packet, or 0 if it has not been received yet
+   */
+  Ptr<Packet> PopInOrder (void);
+
+  /**
+   * \brief Give up waiting for the missing next in-order packet.
+   * Its sequence # is treated as received from now on; if it arrives 
+   * while still within capacity of the next expected one, Insert() tells 
+   * it apart from a duplicate.
+   */
+  void SkipNext (void);
+
+  /**
+   * \brief Find the oldest packet held, i.e. the one right after the gap.
+   * \param seq set to the sequence # of the packet
+   * \return the packet, or 0 if the window is empty
+   */
+  Ptr<Packet> PeekFirst (uint32_t *seq) const;
+
+  /**
+   * \return sequence # of the next in-order packet. Every sequence # 
+   * below it was received, so it doubles as the cumulative ack #.
+   */
+  uint32_t GetNextExpected (void) const;
+
+  /**
+   * \return bitmap of the received packets following the next expected one;
+   * bit i is set when (nextExpected + 1 + i) was received.
+   */
+  uint32_t GetSackBitmap (void) const;
+
+  /**
+   * \param seq a sequence # below the end of the window
+   * \return whether it was received: it is below the next expected one or held
+   */
+  bool IsReceived (uint32_t seq) const;
+
+  /**
+   * \return number of packets held in the window
+   */
+  uint32_t GetNPackets (void) const;
+
+private:
+  bool IsSet (uint32_t slot) const;
+  void Set (uint32_t slot);
+  void Clear (uint32_t slot);
+  static bool IsBitSet (const std::vector<uint64_t> &bitmap, uint32_t slot);
+  static void SetBit (std::vector<uint64_t> &bitmap, uint32_t slot);
+  static void ClearBit (std::vector<uint64_t> &bitmap, uint32_t slot);
+
+  std::vector<Ptr<Packet> > m_slots;  //!< Packets indexed by seq % capacity 
+  std::vector<uint64_t> m_occupied;   //!< Bitmap of occupied slots 
+  std::vector<uint64_t> m_skipped;    //!< Bitmap of slots whose latest seq # below the next expected one was skipped 
+  uint32_t m_nextExpected;            //!< Sequence # of the next in-order packet 
+  uint32_t m_nPackets;                //!< Number of occupied slots 
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_REORDER_BUFFER_H */
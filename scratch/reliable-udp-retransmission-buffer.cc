@@ -0,0 +1,188 @@
+#include <algorithm>
+#include "ns3/assert.h"
+#include "reliable-udp-retransmission-buffer.h"
+
+namespace ns3 {
+
+ReliableUdpRetransmissionBuffer::AckedInfo::AckedInfo ()
+  : packets (0),
+    bytes (0),
+    latestRetries (0)
+{
+}
+
+ReliableUdpRetransmissionBuffer::ReliableUdpRetransmissionBuffer ()
+  : m_base (0),
+    m_end (0),
+    m_nPackets (0)
+{
+}
+
+void
+ReliableUdpRetransmissionBuffer::Entry::GetHeader (ReliableUdpHeader &header) const
+{
+  header.SetSeqNum (seq);
+  header.SetFrameId (frameId);
+  header.SetFragment (fragIndex, fragCount);
+  header.SetFrameType (frameType);
+  header.SetDeadline (deadline);
+}
+
+void
+ReliableUdpRetransmissionBuffer::SetCapacity (uint32_t capacity)
+{
+  NS_ASSERT (capacity > 0);
+  m_slots.assign (capacity, Entry ());
+  m_base = m_end;
+  m_nPackets = 0;
+}
+
+uint32_t
+ReliableUdpRetransmissionBuffer::GetCapacity (void) const
+{
+  return m_slots.size ();
+}
+
+bool
+ReliableUdpRetransmissionBuffer::IsFull (void) const
+{
+  return m_end - m_base >= GetCapacity ();
+}
+
+void
+ReliableUdpRetransmissionBuffer::Insert (ReliableUdpHeader &header, uint32_t payloadSize, Time now)
+{
+  uint32_t seq = header.GetSeqNum ();
+  if (m_nPackets == 0) {
+    // Nothing in flight; the window restarts at this packet 
+    m_base = m_end = seq;
+  }
+  NS_ASSERT_MSG (seq == m_end, "Sequence #s must be inserted without holes");
+  NS_ASSERT (!IsFull ());
+  Entry &e = Slot (seq);
+  e.seq = seq;
+  e.frameId = header.GetFrameId ();
+  e.fragIndex = header.GetFragIndex ();
+  e.fragCount = header.GetFragCount ();
+  e.frameType = header.GetFrameType ();
+  e.payloadSize = payloadSize;
+  e.size = header.GetSerializedSize () + payloadSize;
+  e.sentTime = now;
+  e.retries = 0;
+  e.lost = false;
+  e.deadline = header.GetDeadline ();
+  e.timedOut = false;
+  m_end++;
+  m_nPackets++;
+}
+
+ReliableUdpRetransmissionBuffer::Entry *
+ReliableUdpRetransmissionBuffer::Get (uint32_t seq)
+{
+  if (seq - m_base >= m_end - m_base) {
+    return 0;
+  }
+  Entry &e = Slot (seq);
+  return e.size > 0 ? &e : 0;
+}
+
+bool
+ReliableUdpRetransmissionBuffer::Ack (uint32_t seq, AckedInfo &info)
+{
+  Entry *e = Get (seq);
+  if (e == 0) {
+    return false;
+  }
+  Release (*e, info);
+  // Slide the window over the acked head 
+  while (m_base != m_end && Slot (m_base).size == 0) {
+    m_base++;
+  }
+  return true;
+}
+
+bool
+ReliableUdpRetransmissionBuffer::Remove (uint32_t seq)
+{
+  AckedInfo ignored;
+  return Ack (seq, ignored);
+}
+
+uint32_t
+ReliableUdpRetransmissionBuffer::AckBelow (uint32_t seq, AckedInfo &info)
+{
+  uint32_t released = 0;
+  // Stale acks are behind the window and release nothing 
+  if (int32_t (seq - m_base) <= 0) {
+    return released;
+  }
+  for (uint32_t n = std::min (seq - m_base, m_end - m_base); n > 0; n--) {
+    Entry &e = Slot (m_base);
+    if (e.size > 0) {
+      Release (e, info);
+      released++;
+    }
+    m_base++;
+  }
+  while (m_base != m_end && Slot (m_base).size == 0) {
+    m_base++;
+  }
+  return released;
+}
+
+void
+ReliableUdpRetransmissionBuffer::CancelTimers (void)
+{
+  for (uint32_t seq = m_base; seq != m_end; ++seq) {
+    Entry &e = Slot (seq);
+    e.rtoTimer.Cancel ();
+    e.deadlineTimer.Cancel ();
+  }
+}
+
+uint32_t
+ReliableUdpRetransmissionBuffer::GetBase (void) const
+{
+  return m_base;
+}
+
+uint32_t
+ReliableUdpRetransmissionBuffer::GetEnd (void) const
+{
+  return m_end;
+}
+
+uint32_t
+ReliableUdpRetransmissionBuffer::GetNPackets (void) const
+{
+  return m_nPackets;
+}
+
+uint32_t
+ReliableUdpRetransmissionBuffer::GetMemoryUsage (void) const
+{
+  return m_slots.capacity () * sizeof (Entry);
+}
+
+ReliableUdpRetransmissionBuffer::Entry &
+ReliableUdpRetransmissionBuffer::Slot (uint32_t seq)
+{
+  return m_slots[seq % GetCapacity ()];
+}
+
+void
+ReliableUdpRetransmissionBuffer::Release (Entry &e, AckedInfo &info)
+{
+  if (info.packets == 0 || e.sentTime > info.latestSentTime) {
+    info.latestSentTime = e.sentTime;
+    info.latestRetries = e.retries;
+  }
+  info.packets++;
+  info.bytes += e.size;
+  e.size = 0;
+  e.rtoTimer.Cancel ();
+  e.deadlineTimer.Cancel ();
+  m_nPackets--;
+}
+
+} // namespace ns3
@@ -0,0 +1,156 @@
+#ifndef RELIABLE_UDP_RETRANSMISSION_BUFFER_H
+#define RELIABLE_UDP_RETRANSMISSION_BUFFER_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/nstime.h"
+#include "reliable-udp-header.h"
+#include "reliable-udp-timer-wheel.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Circular buffer of packets sent but not acked yet.
+ *
+ * Packets are stored at slot (seq - base) of a ring, where base is the 
+ * oldest unacked sequence #. Payloads are zero-filled, so a packet is held 
+ * as the header fields fixed when it was built and its payload size, and a 
+ * retransmission is rebuilt from them; the ring is all the storage packets 
+ * in flight take. Insert, ack and lookup are O(1) and a range ack is linear 
+ * in the number of packets it covers. No memory is allocated until 
+ * SetCapacity(), which must precede Insert(), nor after it, and at most 
+ * capacity sequence #s starting from base can be held. Each entry embeds 
+ * its retransmission and deadline timers, which are cancelled when the 
+ * entry is released.
+ */
+class ReliableUdpRetransmissionBuffer
+{
+public:
+  /// State of a packet which was sent but not acked yet.
+  struct Entry
+  {
+    uint32_t seq;        //!< Sequence # 
+    uint32_t frameId;    //!< Frame # 
+    uint16_t fragIndex;  //!< Fragment # within the frame 
+    uint16_t fragCount;  //!< Fragments in the frame 
+    uint8_t frameType;   //!< I/P/B 
+    bool lost;           //!< Reported lost; resend without waiting for RTO 
+    bool timedOut;       //!< RTO of the latest transmission expired; resend 
+    uint32_t payloadSize; //!< Size of the zero-filled payload 
+    uint32_t size;       //!< Size of the packet as first sent, header included; 0 if the slot is free 
+    uint32_t retries;    //!< Number of retransmissions so far 
+    Time sentTime;       //!< Time of the latest (re)transmission 
+    Time deadline;       //!< Useless to the client after it; zero for none 
+    ReliableUdpTimer rtoTimer;      //!< Expires with the RTO of the latest transmission 
+    ReliableUdpTimer deadlineTimer; //!< Expires at the deadline 
+
+    /**
+     * \brief Rebuild the header of the packet as it was built. The fields 
+     * set per transmission are left to the sender.
+     * \param header the header to fill in
+     */
+    void GetHeader (ReliableUdpHeader &header) const;
+  };
+
+  /// Summary of the packets released by acks
+  struct AckedInfo
+  {
+    AckedInfo ();
+    uint32_t packets;     //!< Number of packets released 
+    uint32_t bytes;       //!< Total size of the packets released 
+    Time latestSentTime;  //!< Latest transmission time among released packets 
+    uint32_t latestRetries; //!< Retransmission count of the latest transmitted one 
+  };
+
+  ReliableUdpRetransmissionBuffer ();
+
+  /**
+   * \brief Resize the ring. Stored packets are discarded.
+   * \param capacity number of sequence #s the ring can span
+   */
+  void SetCapacity (uint32_t capacity);
+
+  uint32_t GetCapacity (void) const;
+
+  /**
+   * \return true if the next sequence # cannot be inserted
+   */
+  bool IsFull (void) const;
+
+  /**
+   * \brief Store a packet that has just been sent.
+   * Sequence #s must be inserted in increasing order without holes.
+   * \param header header of the packet; its sequence #, frame fields and deadline are kept
+   * \param payloadSize size of the payload
+   * \param now the transmission time
+   */
+  void Insert (ReliableUdpHeader &header, uint32_t payloadSize, Time now);
+
+  /**
+   * \param seq sequence # of the packet
+   * \return the entry of an unacked packet, or 0 if it is not held
+   */
+  Entry *Get (uint32_t seq);
+
+  /**
+   * \brief Release a single packet.
+   * \param seq sequence # of the packet
+   * \param info accumulates the released packet
+   * \return true if the packet was held
+   */
+  bool Ack (uint32_t seq, AckedInfo &info);
+
+  /**
+   * \brief Release every packet whose sequence # is lower than seq.
+   * \param seq cumulative ack #
+   * \param info accumulates the released packets
+   * \return number of packets released
+   */
+  uint32_t AckBelow (uint32_t seq, AckedInfo &info);
+
+  /**
+   * \brief Give up a packet without it being acked.
+   * \param seq sequence # of the packet
+   * \return true if the packet was held
+   */
+  bool Remove (uint32_t seq);
+
+  /**
+   * \brief Cancel the timers of every packet held.
+   */
+  void CancelTimers (void);
+
+  /**
+   * \return the oldest unacked sequence #
+   */
+  uint32_t GetBase (void) const;
+
+  /**
+   * \return one past the newest inserted sequence #
+   */
+  uint32_t GetEnd (void) const;
+
+  /**
+   * \return number of packets held
+   */
+  uint32_t GetNPackets (void) const;
+
+  /**
+   * \return bytes taken by the ring, not counting the packets
+   */
+  uint32_t GetMemoryUsage (void) const;
+
+private:
+  Entry &Slot (uint32_t seq);
+  void Release (Entry &e, AckedInfo &info);
+
+  std::vector<Entry> m_slots;  //!< Ring of entries indexed by seq % capacity 
+  uint32_t m_base;             //!< Oldest unacked sequence # 
+  uint32_t m_end;              //!< One past the newest inserted sequence # 
+  uint32_t m_nPackets;         //!< Number of packets held 
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_RETRANSMISSION_BUFFER_H */
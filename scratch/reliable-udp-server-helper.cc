@@ -35,6 +35,20 @@ namespace ns3 {
         return apps;
     }
 
+    uint16_t
+    ReliableUdpServerHelper::AddStream(Ptr <Application> app, TypeId frameSourceTypeId, uint32_t weight) {
+        ObjectFactory factory;
+        factory.SetTypeId(frameSourceTypeId);
+        return AddStream(app, factory, weight);
+    }
+
+    uint16_t
+    ReliableUdpServerHelper::AddStream(Ptr <Application> app, const ObjectFactory &frameSource, uint32_t weight) {
+        Ptr <ReliableUdpServer> server = DynamicCast<ReliableUdpServer>(app);
+        NS_ASSERT_MSG(server != 0, "AddStream needs a ReliableUdpServer");
+        return server->AddStream(frameSource, weight);
+    }
+
     Ptr <Application>
     ReliableUdpServerHelper::InstallPriv(Ptr <Node> node) {
         Ptr <Application> app = m_factory.Create<ReliableUdpServer>();
@@ -55,6 +55,28 @@ public:
    */
   ApplicationContainer Install (Ptr<Node> node); 
 
+  /**
+   * \brief Add a stream to every session of an installed ReliableUdpServer.
+   
+   * It may be called before the simulation runs or scheduled while it runs; 
+   * sessions opened later get the stream as well.
+   * \param app The ReliableUdpServer application.
+   * \param frameSourceTypeId Type of the frame source of the stream.
+   * \param weight Share of the stream in the deficit round robin.
+   * \return id of the stream
+   */
+  uint16_t AddStream (Ptr<Application> app, TypeId frameSourceTypeId, uint32_t weight);
+
+  /**
+   * \brief Add a stream to every session of an installed ReliableUdpServer.
+   
+   * \param app The ReliableUdpServer application.
+   * \param frameSource Factory of the frame source of the stream, with its attributes.
+   * \param weight Share of the stream in the deficit round robin.
+   * \return id of the stream
+   */
+  uint16_t AddStream (Ptr<Application> app, const ObjectFactory &frameSource, uint32_t weight);
+
 private:
   /**
    * \brief Install an ns3::ReliableUdpServer on the node configured with all the attributes set with SetAttribute.
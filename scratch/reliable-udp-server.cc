@@ -9,7 +9,17 @@
 #include "ns3/udp-socket.h"
 #include "ns3/simulator.h"
 #include "ns3/drop-tail-queue.h"
-#include <map>
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/object-factory.h"
+#include "ns3/queue-size.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
+#include <algorithm>
+#include <sstream>
+#include <string.h>
 
 #include "reliable-udp-server.h"
 #include "reliable-udp-header.h"
@@ -20,6 +30,8 @@ namespace ns3 {
 
     NS_OBJECT_ENSURE_REGISTERED (ReliableUdpServer);
 
+    const int64_t ReliableUdpServer::STREAM_BLOCK;
+
     TypeId
     ReliableUdpServer::GetTypeId(void) {
         static TypeId tid = TypeId("ns3::ReliableUdpServer")
@@ -29,16 +41,203 @@ namespace ns3 {
                 .AddAttribute("Port", "Port on which we listen for incoming packets.",
                               UintegerValue(9),
                               MakeUintegerAccessor(&ReliableUdpServer::m_port),
-                              MakeUintegerChecker<uint16_t>());
+                              MakeUintegerChecker<uint16_t>())
+                .AddAttribute("WindowSize", "Maximum number of packets in flight.",
+                              UintegerValue(256),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_windowSize),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("RetransmissionBufferSize",
+                              "Number of packets the retransmission buffer can hold. It bounds the window. "
+                              "0 sizes it to twice WindowSize.",
+                              UintegerValue(0),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_rtxBufferSize),
+                              MakeUintegerChecker<uint32_t>())
+                .AddAttribute("RetransmissionTimeout",
+                              "Time after which an unacked packet is resent, until the first RTT sample; "
+                              "then it follows RFC 6298.",
+                              TimeValue(MilliSeconds(200)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_rto),
+                              MakeTimeChecker())
+                .AddAttribute("MinRetransmissionTimeout",
+                              "Lower bound of the retransmission timeout.",
+                              TimeValue(MilliSeconds(20)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_minRto),
+                              MakeTimeChecker())
+                .AddAttribute("MaxRetransmissionTimeout",
+                              "Upper bound of the retransmission timeout, reached by backing off.",
+                              TimeValue(Seconds(60)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_maxRto),
+                              MakeTimeChecker())
+                .AddAttribute("ReorderThreshold",
+                              "Number of later acked packets after which an unacked packet is considered lost.",
+                              UintegerValue(3),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_reorderThreshold),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("CongestionControl",
+                              "Type of the congestion controller, a subclass of ns3::ReliableUdpCongestionControl.",
+                              TypeIdValue(ReliableUdpAimd::GetTypeId()),
+                              MakeTypeIdAccessor(&ReliableUdpServer::m_congestionControlTypeId),
+                              MakeTypeIdChecker())
+                .AddAttribute("PacingRate",
+                              "Rate departures are paced at. If 0, the congestion controller's rate is used, "
+                              "and packets leave as fast as the window allows if it has none.",
+                              DataRateValue(DataRate(0)),
+                              MakeDataRateAccessor(&ReliableUdpServer::m_pacingRate),
+                              MakeDataRateChecker())
+                .AddAttribute("PacingBurst",
+                              "Number of bytes which may leave back to back at the pacing rate.",
+                              UintegerValue(3000),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_pacingBurst),
+                              MakeUintegerChecker<uint32_t>())
+                .AddAttribute("FrameSource",
+                              "Type of the video frame source, a subclass of ns3::ReliableUdpFrameSource.",
+                              TypeIdValue(ReliableUdpGopFrameSource::GetTypeId()),
+                              MakeTypeIdAccessor(&ReliableUdpServer::m_frameSourceTypeId),
+                              MakeTypeIdChecker())
+                .AddAttribute("MaxPayloadSize",
+                              "Max payload of a packet in bytes; frames are fragmented to fit.",
+                              UintegerValue(1400),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_maxPayloadSize),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("PlayoutDelay",
+                              "Time after its timestamp at which a frame is presented; "
+                              "packets which cannot arrive by then are not retransmitted.",
+                              TimeValue(Seconds(1)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_playoutDelay),
+                              MakeTimeChecker())
+                .AddAttribute("TxQueueSize",
+                              "Capacity of the queue of packets waiting to be sent.",
+                              QueueSizeValue(QueueSize("10000p")),
+                              MakeQueueSizeAccessor(&ReliableUdpServer::m_txQueueSize),
+                              MakeQueueSizeChecker())
+                .AddAttribute("SessionTimeout",
+                              "Time without any packet from a client after which its session is removed.",
+                              TimeValue(Seconds(10)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_sessionTimeout),
+                              MakeTimeChecker())
+                .AddAttribute("MaxProbeInterval",
+                              "Max interval between zero window probes; it starts at the RTO and doubles.",
+                              TimeValue(Seconds(1)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_maxProbeInterval),
+                              MakeTimeChecker())
+                .AddAttribute("ReliabilityMode",
+                              "How losses are found: Ack, from the acks and SACKs of every few packets and RTO "
+                              "timers, or Nack, from the gaps the client NACKs. Clients must use the same mode.",
+                              EnumValue(ReliableUdpHeader::ACK_MODE),
+                              MakeEnumAccessor(&ReliableUdpServer::m_reliabilityMode),
+                              MakeEnumChecker(ReliableUdpHeader::ACK_MODE, "Ack",
+                                              ReliableUdpHeader::NACK_MODE, "Nack"))
+                .AddAttribute("KeepaliveInterval",
+                              "In Nack mode, idle time of a stream with packets unacked before a keepalive "
+                              "tells the client the next seq #, so that it can NACK losses at the tail.",
+                              TimeValue(MilliSeconds(100)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_keepaliveInterval),
+                              MakeTimeChecker())
+                .AddAttribute("FecMode",
+                              "Forward error correction of generated packets.",
+                              EnumValue(ReliableUdpFec::NONE),
+                              MakeEnumAccessor(&ReliableUdpServer::m_fecMode),
+                              MakeEnumChecker(ReliableUdpFec::NONE, "None",
+                                              ReliableUdpFec::XOR, "Xor",
+                                              ReliableUdpFec::REED_SOLOMON, "ReedSolomon"))
+                .AddAttribute("FecBlockSize",
+                              "Max data packets per FEC block (K). A block also ends with its frame.",
+                              UintegerValue(8),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_fecBlockSize),
+                              MakeUintegerChecker<uint32_t>(1, 255))
+                .AddAttribute("FecParityCount",
+                              "Parity packets per FEC block (M); always 1 in Xor mode.",
+                              UintegerValue(2),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_fecParityCount),
+                              MakeUintegerChecker<uint32_t>(1, 255))
+                .AddAttribute("BitrateLadder",
+                              "Comma-separated encoding bitrates, e.g. \"500kbps,1Mbps,2Mbps\"; "
+                              "empty streams at the bitrate of the frame source.",
+                              StringValue(""),
+                              MakeStringAccessor(&ReliableUdpServer::m_bitrateLadder),
+                              MakeStringChecker())
+                .AddAttribute("AbrPolicy",
+                              "Type of the adaptive bitrate policy, a subclass of ns3::ReliableUdpAbr.",
+                              TypeIdValue(ReliableUdpThroughputAbr::GetTypeId()),
+                              MakeTypeIdAccessor(&ReliableUdpServer::m_abrTypeId),
+                              MakeTypeIdChecker())
+                .AddAttribute("AbrInterval",
+                              "Time between bitrate decisions.",
+                              TimeValue(Seconds(1)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_abrInterval),
+                              MakeTimeChecker())
+                .AddAttribute("EventTrace",
+                              "File to record per-packet events of all sessions to, in the format "
+                              "of ReliableUdpEventRecorder; empty records none.",
+                              StringValue(""),
+                              MakeStringAccessor(&ReliableUdpServer::m_eventTrace),
+                              MakeStringChecker())
+                .AddAttribute("EventBufferSize",
+                              "Number of events buffered before they are written to the EventTrace file.",
+                              UintegerValue(4096),
+                              MakeUintegerAccessor(&ReliableUdpServer::m_eventBufferSize),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("TimerGranularity",
+                              "Tick of the wheel holding the retransmission and deadline timers of all "
+                              "sessions. Timers expire up to one tick late.",
+                              TimeValue(MilliSeconds(1)),
+                              MakeTimeAccessor(&ReliableUdpServer::m_timerGranularity),
+                              MakeTimeChecker(NanoSeconds(1)))
+                .AddTraceSource("Sessions",
+                                "Number of sessions.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_nSessions),
+                                "ns3::TracedValueCallback::Uint32")
+                .AddTraceSource("NewSession",
+                                "A session was opened; per-session traces can be connected on it.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_newSessionTrace),
+                                "ns3::ReliableUdpServer::SessionTracedCallback")
+                .AddTraceSource("PacketsSent",
+                                "Number of data packets sent for the first time by all sessions.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_packetsSent),
+                                "ns3::TracedValueCallback::Uint32")
+                .AddTraceSource("PacketsRetransmitted",
+                                "Number of data packets sent again by all sessions.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_packetsRetransmitted),
+                                "ns3::TracedValueCallback::Uint32")
+                .AddTraceSource("PacketsAcked",
+                                "Number of data packets acked to all sessions.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_packetsAcked),
+                                "ns3::TracedValueCallback::Uint32")
+                .AddTraceSource("BytesAcked",
+                                "Bytes of the data packets acked to all sessions, headers included.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_bytesAcked),
+                                "ns3::TracedValueCallback::Uint64")
+                .AddTraceSource("PacketsDropped",
+                                "Number of packets dropped by full TX queues or abandoned past their deadline.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_packetsDropped),
+                                "ns3::TracedValueCallback::Uint32")
+                .AddTraceSource("TxQueue",
+                                "Packets waiting in the TX queues of all sessions.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_txQueuePackets),
+                                "ns3::TracedValueCallback::Uint32")
+                .AddTraceSource("RtxBuffer",
+                                "Packets held in the retransmission buffers of all sessions.",
+                                MakeTraceSourceAccessor(&ReliableUdpServer::m_rtxBufferPackets),
+                                "ns3::TracedValueCallback::Uint32");
         return tid;
     }
 
-    ReliableUdpServer::ReliableUdpServer() {
+    size_t
+    ReliableUdpAddressHash::operator()(const Address &address) const {
+        // FNV-1a over the serialized address 
+        uint8_t buffer[Address::MAX_SIZE + 2];
+        uint32_t len = address.CopyAllTo(buffer, sizeof(buffer));
+        size_t hash = 2166136261u;
+        for (uint32_t i = 0; i < len; i++) {
+            hash = (hash ^ buffer[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    ReliableUdpServer::ReliableUdpServer()
+        : m_stream(-1),
+          m_streamsUsed(0) {
         NS_LOG_FUNCTION(this);
-        m_sending = true;
-        m_lastGeneratedSeqNum = -1;
-        m_lastGeneratedSeqNum = -1;
-        m_TxQueue = 0;
     }
 
     ReliableUdpServer::~ReliableUdpServer() {
@@ -49,6 +248,13 @@ namespace ns3 {
     void
     ReliableUdpServer::DoDispose(void) {
         NS_LOG_FUNCTION(this);
+        for (SessionMap::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+            Simulator::Cancel(it->second.idleEvent);
+            it->second.session->Dispose();
+        }
+        m_sessions.clear();
+        m_recorder = 0;
+        m_timerWheel = 0;
         Application::DoDispose();
     }
 
@@ -56,8 +262,6 @@ namespace ns3 {
     ReliableUdpServer::StartApplication(void) {
         NS_LOG_FUNCTION(this);
 
-        if (m_TxQueue == 0) 
-            m_TxQueue = CreateObject<DropTailQueue<Packet> > ();
         if (m_socket == 0) {
             TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
             m_socket = Socket::CreateSocket(GetNode(), tid);
@@ -68,24 +272,36 @@ namespace ns3 {
         }
 
         m_socket->SetRecvCallback(MakeCallback(&ReliableUdpServer::HandleRead, this));
-        m_generatePacketEvent = Simulator::Schedule(
-                MilliSeconds(10),
-                &ReliableUdpServer::GeneratePackets, this
-        );
-        m_sendEvent = Simulator::Schedule(
-                MilliSeconds(33),
-                &ReliableUdpServer::Send, this
-        );
+
+        if (!m_eventTrace.empty() && m_recorder == 0) {
+            m_recorder = Create<ReliableUdpEventRecorder>();
+            m_recorder->Open(m_eventTrace, m_eventBufferSize);
+        }
+        if (m_timerWheel == 0) {
+            // One wheel for all sessions, so the simulator sees one event per tick
+            m_timerWheel = Create<ReliableUdpTimerWheel>(m_timerGranularity);
+        }
     }
 
     void
     ReliableUdpServer::StopApplication() {
         NS_LOG_FUNCTION(this);
 
+        for (SessionMap::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+            Simulator::Cancel(it->second.idleEvent);
+            it->second.session->Stop();
+        }
+
         if (m_socket != 0) {
             m_socket->Close();
             m_socket->SetRecvCallback(MakeNullCallback < void, Ptr < Socket > > ());
         }
+        if (m_recorder != 0) {
+            m_recorder->Close();
+        }
+        if (m_timerWheel != 0) {
+            m_timerWheel->Clear();
+        }
     }
 
     void
@@ -94,12 +310,14 @@ namespace ns3 {
 
         Ptr<Packet> packet;
         Address from;
-        Address localAddress;
         ReliableUdpHeader header;
 
         while ((packet = socket->RecvFrom(from))) {
-            socket->GetSockName(localAddress);
             packet->PeekHeader(header);
+            if (header.GetVersion() != ReliableUdpHeader::VERSION) {
+                NS_LOG_WARN("Drop packet of header version " << (uint32_t) header.GetVersion());
+                continue;
+            }
             if (InetSocketAddress::IsMatchingType(from)) {
                 NS_LOG_INFO("At time " << Simulator::Now().GetSeconds()
                                        << "s server received " << packet->GetSize()
@@ -108,59 +326,158 @@ namespace ns3 {
                                        << " seq " << header.GetSeqNum()
                                        << " ack " << header.GetAckNum());
             }
-            if (header.GetSignal()) {
-                m_sending = false;
+            SessionMap::iterator it = m_sessions.find(from);
+            if (it != m_sessions.end()) {
+                it->second.session->Receive(header);
+            } else if (header.GetFlags() & ReliableUdpHeader::FLAG_HELLO) {
+                CreateSession(from)->Receive(header);
             } else {
-                m_unAckedPackets.erase(header.GetAckNum());
+                // Its session timed out; a hello back tells the client to open a new one
+                NS_LOG_INFO("Answer packet of unknown client with a hello");
+                ReliableUdpHeader helloHeader;
+                helloHeader.SetFlags(ReliableUdpHeader::FLAG_HELLO);
+                Ptr<Packet> headerOnlyPacket = Create<Packet>(0);
+                headerOnlyPacket->AddHeader(helloHeader);
+                m_socket->SendTo(headerOnlyPacket, 0, from);
             }
         }
     }
 
+    Ptr<ReliableUdpSession>
+    ReliableUdpServer::CreateSession(const Address &peer) {
+        ReliableUdpSession::Config config;
+        config.windowSize = m_windowSize;
+        config.rtxBufferSize = m_rtxBufferSize;
+        config.rto = m_rto;
+        config.minRto = m_minRto;
+        config.maxRto = m_maxRto;
+        config.reorderThreshold = m_reorderThreshold;
+        config.congestionControlTypeId = m_congestionControlTypeId;
+        config.pacingRate = m_pacingRate;
+        config.pacingBurst = m_pacingBurst;
+        config.maxPayloadSize = m_maxPayloadSize;
+        config.playoutDelay = m_playoutDelay;
+        config.txQueueSize = m_txQueueSize;
+        config.maxProbeInterval = m_maxProbeInterval;
+        config.fecMode = m_fecMode;
+        config.fecBlockSize = m_fecBlockSize;
+        config.fecParityCount = m_fecParityCount;
+        std::istringstream ladder(m_bitrateLadder);
+        std::string rate;
+        while (std::getline(ladder, rate, ',')) {
+            if (!rate.empty()) {
+                config.bitrateLadder.push_back(DataRate(rate));
+            }
+        }
+        std::sort(config.bitrateLadder.begin(), config.bitrateLadder.end());
+        config.abrTypeId = m_abrTypeId;
+        config.abrInterval = m_abrInterval;
+        config.recorder = m_recorder;
+        config.timerWheel = m_timerWheel;
+        config.reliabilityMode = m_reliabilityMode;
+        config.keepaliveInterval = m_keepaliveInterval;
+
+        SessionEntry &entry = m_sessions[peer];
+        entry.session = CreateObject<ReliableUdpSession>();
+        entry.session->TraceConnectWithoutContext("PacketsSent",
+                MakeBoundCallback(&ReliableUdpServer::Accumulate<uint32_t>, &m_packetsSent));
+        entry.session->TraceConnectWithoutContext("PacketsRetransmitted",
+                MakeBoundCallback(&ReliableUdpServer::Accumulate<uint32_t>, &m_packetsRetransmitted));
+        entry.session->TraceConnectWithoutContext("PacketsAcked",
+                MakeBoundCallback(&ReliableUdpServer::Accumulate<uint32_t>, &m_packetsAcked));
+        entry.session->TraceConnectWithoutContext("BytesAcked",
+                MakeBoundCallback(&ReliableUdpServer::Accumulate<uint64_t>, &m_bytesAcked));
+        entry.session->TraceConnectWithoutContext("PacketsDropped",
+                MakeBoundCallback(&ReliableUdpServer::Accumulate<uint32_t>, &m_packetsDropped));
+        entry.session->TraceConnectWithoutContext("TxQueue",
+                MakeBoundCallback(&ReliableUdpServer::Accumulate<uint32_t>, &m_txQueuePackets));
+        entry.session->TraceConnectWithoutContext("RtxBuffer",
+                MakeBoundCallback(&ReliableUdpServer::Accumulate<uint32_t>, &m_rtxBufferPackets));
+        entry.session->Start(m_socket, peer, config);
+        ObjectFactory factory;
+        factory.SetTypeId(m_frameSourceTypeId);
+        entry.session->AddStream(0, CreateFrameSource(factory), 1);
+        for (uint32_t i = 0; i < m_extraStreams.size(); i++) {
+            entry.session->AddStream(i + 1, CreateFrameSource(m_extraStreams[i].frameSource),
+                                     m_extraStreams[i].weight);
+        }
+        entry.idleEvent = Simulator::Schedule(m_sessionTimeout, &ReliableUdpServer::CheckIdle, this, peer);
+        m_nSessions = m_sessions.size();
+        NS_LOG_INFO("Session " << m_sessions.size() << " opened, using "
+                    << entry.session->GetMemoryUsage() << " bytes");
+        m_newSessionTrace(entry.session);
+        return entry.session;
+    }
+
     void
-    ReliableUdpServer::GeneratePackets() {
-        uint32_t packetSize = 1024;
-        uint8_t dataBuffer[packetSize];
-        Ptr <Packet> packet = Create<Packet>(dataBuffer, packetSize);
+    ReliableUdpServer::CheckIdle(Address peer) {
+        SessionMap::iterator it = m_sessions.find(peer);
+        if (it == m_sessions.end()) {
+            return;
+        }
+        Time idle = Simulator::Now() - it->second.session->GetLastActivity();
+        if (idle < m_sessionTimeout) {
+            it->second.idleEvent = Simulator::Schedule(m_sessionTimeout - idle,
+                                                       &ReliableUdpServer::CheckIdle, this, peer);
+            return;
+        }
+        NS_LOG_INFO("Session timed out after " << idle.GetSeconds() << "s of silence");
+        it->second.session->Dispose();
+        m_sessions.erase(it);
+        m_nSessions = m_sessions.size();
+    }
 
-        ReliableUdpHeader header;
-        header.SetSeqNum(++m_lastGeneratedSeqNum);
-        header.SetRetransmit(0);
+    uint32_t
+    ReliableUdpServer::GetNSessions(void) const {
+        return m_sessions.size();
+    }
 
-        packet->AddHeader(header);
-        m_TxQueue->Enqueue(packet);
+    Ptr<ReliableUdpSession>
+    ReliableUdpServer::GetSession(const Address &peer) const {
+        SessionMap::const_iterator it = m_sessions.find(peer);
+        if (it == m_sessions.end()) {
+            return 0;
+        }
+        return it->second.session;
+    }
 
-        m_generatePacketEvent = Simulator::Schedule(
-                MilliSeconds(10),
-                &ReliableUdpServer::GeneratePackets, this
-        );
+    uint64_t
+    ReliableUdpServer::GetMemoryUsage(void) const {
+        uint64_t bytes = 0;
+        for (SessionMap::const_iterator it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+            bytes += sizeof(SessionEntry) + it->second.session->GetMemoryUsage();
+        }
+        return bytes;
     }
 
-    void
-    ReliableUdpServer::Send() {
-        InetSocketAddress client ("10.1.1.1", 9);
-        ReliableUdpHeader header;
-        if (m_sending) {
-            if ((!m_unAckedPackets.empty())) {
-                for (std::map<uint32_t, Packet>::iterator it = m_unAckedPackets.begin(); 
-                     it != m_unAckedPackets.end(); ++it) {
-                    m_socket->SendTo(&(it->second), 0, client);
-                }
-                m_unAckedPackets.clear();
-            } else {
-                while (!m_TxQueue->IsEmpty()) {
-                    Ptr <Packet> p = m_TxQueue->Peek()->Copy();
-                    p->PeekHeader(header);
-                    m_socket->SendTo(p, 0, client);
-                    m_lastSentSeqNum = header.GetSeqNum();
-                    m_TxQueue->Dequeue();
-                    m_unAckedPackets[header.GetSeqNum()] = *p;
-                }
-            }
+    uint16_t
+    ReliableUdpServer::AddStream(const ObjectFactory &frameSource, uint32_t weight) {
+        StreamConfig stream;
+        stream.frameSource = frameSource;
+        stream.weight = weight;
+        m_extraStreams.push_back(stream);
+        uint16_t streamId = m_extraStreams.size();
+        NS_LOG_INFO("Stream " << streamId << " added with weight " << weight);
+        for (SessionMap::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+            it->second.session->AddStream(streamId, CreateFrameSource(stream.frameSource), weight);
         }
-        m_sendEvent = Simulator::Schedule(
-            MilliSeconds(33),
-            &ReliableUdpServer::Send, this
-        );
+        return streamId;
     }
-}
 
+    int64_t
+    ReliableUdpServer::AssignStreams(int64_t stream) {
+        NS_LOG_FUNCTION(this << stream);
+        m_stream = stream;
+        m_streamsUsed = 0;
+        return STREAM_BLOCK;
+    }
+
+    Ptr<ReliableUdpFrameSource>
+    ReliableUdpServer::CreateFrameSource(const ObjectFactory &factory) {
+        Ptr<ReliableUdpFrameSource> source = factory.Create<ReliableUdpFrameSource>();
+        if (m_stream >= 0) {
+            m_streamsUsed += source->AssignStreams(m_stream + m_streamsUsed % STREAM_BLOCK);
+        }
+        return source;
+    }
+}
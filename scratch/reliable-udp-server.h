@@ -7,7 +7,17 @@
 #include "ns3/address.h"
 #include "ns3/traced-callback.h"
 #include "ns3/queue.h"
-#include <map>
+#include "ns3/nstime.h"
+#include "ns3/traced-value.h"
+#include "ns3/type-id.h"
+#include "ns3/data-rate.h"
+#include "ns3/queue-size.h"
+#include "ns3/object-factory.h"
+#include "reliable-udp-session.h"
+#include "reliable-udp-event-recorder.h"
+#include "reliable-udp-timer-wheel.h"
+#include <unordered_map>
+#include <vector>
 
 
 namespace ns3 {
@@ -20,14 +30,27 @@ class Packet;
  * \defgroup reliableudpserver ReliableUdpServer
  */
 
+/**
+ * \ingroup reliableudpserver
+ * \brief Hash of an Address over its type, length and bytes.
+ */
+struct ReliableUdpAddressHash
+{
+  size_t operator() (const Address &address) const;
+};
+
 /**
  * \ingroup reliableudpserver
 
- * \brief A UDP server, sends UDP packets to a client in a reliable way.
+ * \brief A UDP server, sends UDP packets to clients in a reliable way.
  
- * UDP packets are divided from frames and enqueued to particular queue when 
- * they are not a retransmitted one. The retransmitted packets are enqueued  
- * to the other particular queue for reliability. 
+ * Each client announces itself with a hello and gets its own 
+ * ReliableUdpSession, found by its address in a hash table, so handling a 
+ * packet is O(1) in the number of clients. UDP packets are divided from 
+ * frames and enqueued to the TX queue of the session; sent packets stay in 
+ * its retransmission buffer until acked. A session whose client is silent 
+ * for SessionTimeout is removed. With ReliabilityMode Nack, packets are 
+ * resent when the client NACKs them instead of on SACKs and timeouts.
  */
 class ReliableUdpServer : public Application
 {
@@ -42,6 +65,51 @@ public:
 
   virtual ~ReliableUdpServer();
 
+  /**
+   * \return number of active sessions
+   */
+  uint32_t GetNSessions (void) const;
+
+  /**
+   * \param peer address of a client
+   * \return its session, or 0 if it has none
+   */
+  Ptr<ReliableUdpSession> GetSession (const Address &peer) const;
+
+  /**
+   * \return bytes held by all sessions
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+  /**
+   * \brief Add a stream to every session, current and future.
+   * Stream 0 streams frames of the FrameSource attribute with weight 1; 
+   * each added stream gets the next id. It may be called while running.
+   * \param frameSource factory of the frame source of the stream in each session
+   * \param weight share of the stream in the deficit round robin
+   * \return id of the stream
+   */
+  uint16_t AddStream (const ObjectFactory &frameSource, uint32_t weight);
+
+  /**
+   * \brief Assign fixed random variable streams to the frame sources of the sessions.
+   * Frame sources take the streams of the block one after the other in the 
+   * order they are created, so a run does not depend on how many random 
+   * variables were created before, in this process or in others of a 
+   * distributed simulation. Past the end of the block streams are reused.
+   * \param stream first stream index of the block
+   * \return the number of stream indices reserved, STREAM_BLOCK
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /// Stream indices reserved by AssignStreams()
+  static const int64_t STREAM_BLOCK = 1 << 16;
+
+  /**
+   * TracedCallback signature for a new session.
+   * \param [in] session the session
+   */
+  typedef void (* SessionTracedCallback)(Ptr<ReliableUdpSession> session);
 
 protected:
   virtual void DoDispose (void);
@@ -52,47 +120,111 @@ private:
 
   /**
    * \brief Handle a packet reception. 
-   * The packet the server receives is either an ack or a request to stop sending.  
-   * If ack is received, remove corresponding packet from m_unAckedPackets.
-   * If stop request is received, set m_sending flag false. 
+   * The packet is handed to the session of its sender. A hello from an 
+   * unknown sender opens a session; other packets of unknown senders, 
+   * such as late acks of a removed session, are dropped.
    * This function is called by lower layers.
    * \param socket the socket which is a packet was received to.
    */
   void HandleRead (Ptr<Socket> socket);
- 
+
   /**
-   * \brief Generate packets and enqueue into m_TxQueue.
-   * It is called periodically, and if there is room in the TxQueue, add more packets.
-   * m_lastGeneratedSeqNum should be managed here. 
+   * \brief Open a session and start streaming to a client.
+   * \param peer address of the client
+   * \return the session
    */
-  void GeneratePackets (void);
+  Ptr<ReliableUdpSession> CreateSession (const Address &peer);
 
   /**
-   * \brief It transmits the appropriate packet according to the situation.
-   * If m_unAckedPackets is not empty, retransmit all packets in it. 
-   * else transmit some packets in m_TxQueue, and move them to m_unAckedPackets
-   * Note that new packets should not be sent if m_sending is false. 
-  */
-  void Send (void);
-
-  Ptr<Socket> m_socket;  //!< Ipv4 Socket
-  uint16_t m_port;       //!< Port on which we listen for incoming packets 
-
-  uint32_t m_lastGeneratedSeqNum;  //!< Sequence # of recently generated packet 
-  uint32_t m_lastSentSeqNum;       //!< Sequence # of recently sent packet 
+   * \brief Create a frame source, on the next assigned stream if any.
+   * \param factory factory of the frame source
+   * \return the frame source
+   */
+  Ptr<ReliableUdpFrameSource> CreateFrameSource (const ObjectFactory &factory);
 
-  // Packets waiting to be transmitted
-  Ptr<Queue<Packet> > m_TxQueue;  
+  /**
+   * \brief Remove the session of a client if it was silent for m_sessionTimeout.
+   * Otherwise check again when it would be.
+   * \param peer address of the client
+   */
+  void CheckIdle (Address peer);
 
-  // Packets sent but not acked. This acts as a retransmission buffer. 
-  // key: sequence #, value: packet 
-  // Why map? It enables quick search and delete. 
-  std::map<uint32_t, Packet> m_unAckedPackets;  
+  /**
+   * \brief Carry the change of a session counter or gauge over to the total of the server.
+   * \param total the total of the server
+   * \param oldValue value of the session before the change
+   * \param newValue value of the session after the change
+   */
+  template <typename T>
+  static void Accumulate (TracedValue<T> *total, T oldValue, T newValue)
+  {
+    *total = total->Get () + newValue - oldValue;
+  }
+
+  /// A session and the event checking it for idleness
+  struct SessionEntry
+  {
+    Ptr<ReliableUdpSession> session; //!< The session 
+    EventId idleEvent;               //!< Event to call CheckIdle() 
+  };
+  typedef std::unordered_map<Address, SessionEntry, ReliableUdpAddressHash> SessionMap;
+
+  /// A stream added with AddStream()
+  struct StreamConfig
+  {
+    ObjectFactory frameSource; //!< Factory of its frame sources 
+    uint32_t weight;           //!< Share in the deficit round robin 
+  };
 
-  bool m_sending; // !< Indicates whether to send new packets or not. 
+  Ptr<Socket> m_socket;  //!< Ipv4 Socket
+  uint16_t m_port;       //!< Port on which we listen for incoming packets 
 
-  EventId m_generatePacketEvent;  //!< Event to call GeneratePackets() periodically 
-  EventId m_sendEvent;            //!< Event to call Send() periodically 
+  SessionMap m_sessions;       //!< Sessions by client address 
+  Time m_sessionTimeout;       //!< Silence after which a session is removed 
+  TracedValue<uint32_t> m_nSessions; //!< Number of sessions 
+  TracedCallback<Ptr<ReliableUdpSession> > m_newSessionTrace; //!< Fired when a session opens 
+
+  // Totals of the counters and gauges of all sessions; counters keep
+  // what removed sessions counted
+  TracedValue<uint32_t> m_packetsSent;          //!< Data packets sent for the first time 
+  TracedValue<uint32_t> m_packetsRetransmitted; //!< Data packets sent again 
+  TracedValue<uint32_t> m_packetsAcked;         //!< Data packets released by acks 
+  TracedValue<uint64_t> m_bytesAcked;           //!< Bytes of the packets released by acks 
+  TracedValue<uint32_t> m_packetsDropped;       //!< Packets dropped or abandoned 
+  TracedValue<uint32_t> m_txQueuePackets;       //!< Packets in all TX queues 
+  TracedValue<uint32_t> m_rtxBufferPackets;     //!< Packets in all retransmission buffers 
+
+  // Settings handed to every session
+  QueueSize m_txQueueSize;     //!< Capacity of a TX queue 
+  TypeId m_frameSourceTypeId;  //!< Type of the frame source of stream 0 
+  std::vector<StreamConfig> m_extraStreams; //!< Streams 1, 2, ... of every session 
+  int64_t m_stream;            //!< First assigned stream; negative until AssignStreams() 
+  int64_t m_streamsUsed;       //!< Assigned streams taken by frame sources 
+  uint32_t m_maxPayloadSize;   //!< Max payload of a fragment in bytes 
+  Time m_playoutDelay;         //!< Deadline of a frame relative to its timestamp 
+  ReliableUdpFec::Mode m_fecMode;     //!< FEC mode; NONE disables FEC 
+  uint32_t m_fecBlockSize;     //!< Max data packets per FEC block (K) 
+  uint32_t m_fecParityCount;   //!< Parity packets per FEC block (M) 
+  std::string m_bitrateLadder; //!< Comma-separated encoding bitrates 
+  TypeId m_abrTypeId;          //!< Type of the adaptive bitrate policy of a stream 
+  Time m_abrInterval;          //!< Time between bitrate decisions 
+  uint32_t m_rtxBufferSize;    //!< Capacity of a retransmission buffer in packets; 0 for twice m_windowSize 
+  uint32_t m_windowSize;       //!< Max # of packets in flight 
+  Time m_rto;                  //!< Retransmission timeout until the first RTT sample 
+  Time m_minRto;               //!< Lower bound of the retransmission timeout 
+  Time m_maxRto;               //!< Upper bound of the retransmission timeout 
+  uint32_t m_reorderThreshold; //!< Reordering tolerated before declaring loss 
+  TypeId m_congestionControlTypeId; //!< Type of the congestion controller of a session 
+  DataRate m_pacingRate;       //!< Fixed pacing rate; 0 to use the controller's 
+  uint32_t m_pacingBurst;      //!< Depth of the pacing bucket in bytes 
+  Time m_maxProbeInterval;     //!< Cap of the zero window probe interval 
+  std::string m_eventTrace;    //!< File to record events to; empty records none 
+  uint32_t m_eventBufferSize;  //!< Events buffered before they are written out 
+  Ptr<ReliableUdpEventRecorder> m_recorder; //!< Records events of all sessions; 0 for none 
+  Time m_timerGranularity;     //!< Tick of the timer wheel 
+  Ptr<ReliableUdpTimerWheel> m_timerWheel; //!< Retransmission and deadline timers of all sessions
+  ReliableUdpHeader::ReliabilityMode m_reliabilityMode; //!< How losses are found 
+  Time m_keepaliveInterval;    //!< Idle time before a keepalive in NACK_MODE  
 };
 
 } // namespace ns3
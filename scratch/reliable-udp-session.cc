@@ -0,0 +1,840 @@
+#include <algorithm>
+#include <cmath>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/packet.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/object-factory.h"
+#include "ns3/trace-source-accessor.h"
+#include "reliable-udp-session.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpSession");
+NS_OBJECT_ENSURE_REGISTERED (ReliableUdpSession);
+
+TypeId
+ReliableUdpSession::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReliableUdpSession")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<ReliableUdpSession> ()
+    .AddTraceSource ("CongestionWindow",
+                     "Congestion window in packets.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_cWnd),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("FecParitySent",
+                     "Number of FEC parity packets sent.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_fecParitySent),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("Srtt",
+                     "Smoothed RTT.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_srtt),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("Rttvar",
+                     "RTT variation.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_rttvar),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("Rto",
+                     "Retransmission timeout.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_rto),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("BitrateSwitch",
+                     "A stream switched to another rung of the bitrate ladder.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_bitrateSwitchTrace),
+                     "ns3::ReliableUdpSession::BitrateSwitchTracedCallback")
+    .AddTraceSource ("PacketsSent",
+                     "Number of data packets sent for the first time.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_packetsSent),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("PacketsRetransmitted",
+                     "Number of data packets sent again.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_packetsRetransmitted),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("PacketsAcked",
+                     "Number of data packets released by acks.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_packetsAcked),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("BytesAcked",
+                     "Bytes of the data packets released by acks, headers included.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_bytesAcked),
+                     "ns3::TracedValueCallback::Uint64")
+    .AddTraceSource ("PacketsDropped",
+                     "Number of packets dropped by a full TX queue or abandoned past their deadline.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_packetsDropped),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("TxQueue",
+                     "Packets waiting in the TX queues of all streams.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_txQueuePackets),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("RtxBuffer",
+                     "Packets held in the retransmission buffers of all streams.",
+                     MakeTraceSourceAccessor (&ReliableUdpSession::m_rtxBufferPackets),
+                     "ns3::TracedValueCallback::Uint32")
+  ;
+  return tid;
+}
+
+ReliableUdpSession::Stream::Stream ()
+  : id (0),
+    weight (1),
+    deficit (0),
+    lastGeneratedSeqNum (-1),
+    lastSentSeqNum (-1),
+    forwardSeq (0),
+    rwndEdge (0),
+    highestAckNum (0),
+    rung (0),
+    ackedBytes (0),
+    sentPackets (0),
+    lostPackets (0)
+{
+}
+
+ReliableUdpSession::ReliableUdpSession ()
+  : m_drrNext (0),
+    m_drrCredited (false),
+    m_recoveryTime (Seconds (-1)),
+    m_tokens (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+ReliableUdpSession::~ReliableUdpSession ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+ReliableUdpSession::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+  m_socket = 0;
+  m_streams.clear ();
+  // Whoever sums the gauges of sessions lets go of this one 
+  m_txQueuePackets = 0;
+  m_rtxBufferPackets = 0;
+  m_congestionControl = 0;
+  Object::DoDispose ();
+}
+
+void
+ReliableUdpSession::Start (Ptr<Socket> socket, const Address &peer, const Config &config)
+{
+  NS_LOG_FUNCTION (this);
+  m_socket = socket;
+  m_peer = peer;
+  m_config = config;
+  m_lastActivity = Simulator::Now ();
+  m_rto = m_config.rto;
+  if (m_config.timerWheel == 0) {
+    m_config.timerWheel = Create<ReliableUdpTimerWheel> (MilliSeconds (1));
+  }
+
+  ObjectFactory factory;
+  factory.SetTypeId (m_config.congestionControlTypeId);
+  m_congestionControl = factory.Create<ReliableUdpCongestionControl> ();
+  m_cWnd = m_congestionControl->GetCongestionWindow ();
+  m_tokens = m_config.pacingBurst;
+  m_lastRefill = Simulator::Now ();
+}
+
+void
+ReliableUdpSession::AddStream (uint16_t streamId, Ptr<ReliableUdpFrameSource> frameSource, uint32_t weight)
+{
+  NS_LOG_FUNCTION (this << streamId << weight);
+  NS_ASSERT_MSG (m_streams.find (streamId) == m_streams.end (), "Stream " << streamId << " already exists");
+  Stream &s = m_streams[streamId];
+  s.id = streamId;
+  s.weight = std::max (weight, 1u);
+  s.frameSource = frameSource;
+  s.txQueue = CreateObject<DropTailQueue<Packet> > ();
+  s.txQueue->SetMaxSize (m_config.txQueueSize);
+  // Twice the window leaves room for a full window sent behind packets 
+  // still missing 
+  s.unAckedPackets.SetCapacity (m_config.rtxBufferSize > 0 ? m_config.rtxBufferSize
+                                : 2 * m_config.windowSize);
+  // Until the first ack tells otherwise, the client can take a window
+  s.rwndEdge = m_config.windowSize;
+  s.probeInterval = m_rto;
+  s.fecEncoder.Configure (m_config.fecMode, m_config.fecBlockSize, m_config.fecParityCount,
+                          m_config.maxPayloadSize);
+
+  if (!m_config.bitrateLadder.empty ()) {
+    // Start low and climb as the path proves itself 
+    if (s.frameSource->SetBitrate (m_config.bitrateLadder[0])) {
+      ObjectFactory factory;
+      factory.SetTypeId (m_config.abrTypeId);
+      s.abr = factory.Create<ReliableUdpAbr> ();
+      s.abrStart = Simulator::Now ();
+    } else {
+      NS_LOG_WARN ("Frame source of stream " << streamId << " cannot switch bitrate");
+    }
+  }
+
+  s.streamStart = Simulator::Now ();
+  if (s.frameSource->GetNextFrame (s.nextFrame)) {
+    s.generatePacketEvent = Simulator::Schedule (
+      s.nextFrame.timestamp,
+      &ReliableUdpSession::GeneratePackets, this, streamId
+    );
+  }
+}
+
+void
+ReliableUdpSession::Stop (void)
+{
+  for (std::map<uint16_t, Stream>::iterator it = m_streams.begin (); it != m_streams.end (); ++it) {
+    Simulator::Cancel (it->second.generatePacketEvent);
+    Simulator::Cancel (it->second.probeEvent);
+    Simulator::Cancel (it->second.keepaliveEvent);
+    it->second.unAckedPackets.CancelTimers ();
+  }
+  Simulator::Cancel (m_sendEvent);
+}
+
+void
+ReliableUdpSession::Receive (ReliableUdpHeader &header)
+{
+  m_lastActivity = Simulator::Now ();
+  std::map<uint16_t, Stream>::iterator it = m_streams.find (header.GetStreamId ());
+  if (it == m_streams.end ()) {
+    NS_LOG_WARN ("Ack of unknown stream " << header.GetStreamId ());
+    return;
+  }
+  it->second.bufferLevel = header.GetBufferLevel ();
+  UpdateReceiveWindow (it->second, header.GetAckNum (), header.GetWindowEdge ());
+  HandleAck (it->second, header.GetAckNum (), header.GetSackBitmap (), header.GetTimestampEcho ());
+  if (header.GetNackBitmap () != 0) {
+    HandleNack (it->second, header.GetNackBase (), header.GetNackBitmap ());
+  }
+}
+
+Address
+ReliableUdpSession::GetPeer (void) const
+{
+  return m_peer;
+}
+
+Time
+ReliableUdpSession::GetLastActivity (void) const
+{
+  return m_lastActivity;
+}
+
+uint32_t
+ReliableUdpSession::GetMemoryUsage (void) const
+{
+  // Packets in flight are held as headers in unAckedPackets, so queued
+  // bytes and the rings cover what a session holds
+  uint32_t bytes = sizeof (*this);
+  for (std::map<uint16_t, Stream>::const_iterator it = m_streams.begin (); it != m_streams.end (); ++it) {
+    const Stream &s = it->second;
+    bytes += sizeof (s);
+    bytes += s.unAckedPackets.GetMemoryUsage ();
+    bytes += s.repairs.size () * sizeof (uint32_t);
+    bytes += s.fecEncoder.GetMemoryUsage ();
+    if (s.txQueue != 0) {
+      bytes += s.txQueue->GetNBytes ();
+    }
+  }
+  return bytes;
+}
+
+void
+ReliableUdpSession::GeneratePackets (uint16_t streamId)
+{
+  Stream &s = m_streams[streamId];
+  if (s.abr != 0 && Simulator::Now () - s.abrStart >= m_config.abrInterval) {
+    UpdateBitrate (s);
+  }
+  std::vector<Ptr<Packet> > parity;
+  uint32_t maxPayloadSize = m_config.maxPayloadSize;
+  uint32_t fragCount = (s.nextFrame.size + maxPayloadSize - 1) / maxPayloadSize;
+  for (uint32_t i = 0; i < fragCount; i++) {
+    uint32_t packetSize = std::min (maxPayloadSize, s.nextFrame.size - i * maxPayloadSize);
+    Ptr<Packet> packet = Create<Packet> (packetSize);
+
+    ReliableUdpHeader header;
+    header.SetStreamId (s.id);
+    header.SetSeqNum (++s.lastGeneratedSeqNum);
+    header.SetRetransmit (0);
+    header.SetFrameId (s.nextFrame.id);
+    header.SetFragment (i, fragCount);
+    header.SetFrameType (s.nextFrame.type);
+    header.SetDeadline (s.streamStart + s.nextFrame.timestamp + m_config.playoutDelay);
+
+    packet->AddHeader (header);
+    if (!s.txQueue->Enqueue (packet)) {
+      // Give the sequence # back so that the stream has no hole
+      NS_LOG_WARN ("TxQueue of stream " << s.id << " full, dropping the rest of frame " << s.nextFrame.id);
+      s.lastGeneratedSeqNum--;
+      m_packetsDropped += fragCount - i;
+      if (m_config.recorder != 0) {
+        m_config.recorder->Record (ReliableUdpEventRecorder::TX_DROP, s.id, s.lastGeneratedSeqNum + 1, fragCount - i);
+      }
+      break;
+    }
+    s.fecEncoder.AddPacket (packet, parity);
+    EnqueueParity (s, parity);
+  }
+  // A block never waits for the next frame
+  s.fecEncoder.Flush (parity);
+  EnqueueParity (s, parity);
+  UpdateOccupancy ();
+  ScheduleSend (Seconds (0));
+
+  if (s.frameSource->GetNextFrame (s.nextFrame)) {
+    Time delay = s.streamStart + s.nextFrame.timestamp - Simulator::Now ();
+    s.generatePacketEvent = Simulator::Schedule (
+      delay.IsNegative () ? Seconds (0) : delay,
+      &ReliableUdpSession::GeneratePackets, this, streamId
+    );
+  }
+}
+
+void
+ReliableUdpSession::Send (void)
+{
+  ReliableUdpHeader header;
+  Time now = Simulator::Now ();
+  DataRate rate = GetPacingRate ();
+  if (rate.GetBitRate () > 0) {
+    m_tokens = std::min (m_tokens + rate.GetBitRate () * (now - m_lastRefill).GetSeconds () / 8,
+                         double (m_config.pacingBurst));
+  }
+  m_lastRefill = now;
+
+  // Repairs go first whatever the stream: resend only packets whose
+  // RTO expired or which were reported lost. Their timers and the loss
+  // detection queue them, so packets in flight are not walked.
+  bool paced = false;
+  bool timedOut = false;
+  std::map<uint16_t, Stream>::iterator it;
+  for (it = m_streams.begin (); it != m_streams.end () && !paced; ++it) {
+    Stream &s = it->second;
+    while (!s.repairs.empty ()) {
+      uint32_t seq = s.repairs.front ();
+      ReliableUdpRetransmissionBuffer::Entry *record = s.unAckedPackets.Get (seq);
+      if (!record || (!record->lost && !record->timedOut)) {
+        // Acked or abandoned since it was queued
+        s.repairs.pop_front ();
+        continue;
+      }
+      if (!record->deadline.IsZero ()
+          && now + Seconds (m_srtt.Get ().GetSeconds () / 2) > record->deadline) {
+        // It would arrive too late to be played; skip it
+        Abandon (s, seq);
+        s.repairs.pop_front ();
+        continue;
+      }
+      if (!ConsumeTokens (record->size, rate)) {
+        paced = true;
+        break;
+      }
+      // Timers of packets sent before the last backoff belong to its episode
+      timedOut = timedOut || (!record->lost && record->sentTime > m_recoveryTime);
+      s.lostPackets += !record->lost;
+      s.sentPackets++;
+      Retransmit (s, *record);
+      s.repairs.pop_front ();
+    }
+  }
+  if (timedOut) {
+    // Back off until a new RTT sample resets the timeout 
+    m_rto = std::min (m_rto.Get () + m_rto.Get (), m_config.maxRto);
+    m_congestionControl->OnTimeout ();
+    m_recoveryTime = now;
+    m_cWnd = m_congestionControl->GetCongestionWindow ();
+  }
+
+  // New packets keep flowing while retransmissions are pending. Streams
+  // take turns by deficit round robin: each turn credits a stream with
+  // weight quanta of one full packet, and it sends while its deficit
+  // covers the head of its queue. A turn cut short by pacing or the
+  // window resumes at the same stream without a second credit.
+  uint32_t window = std::min (m_config.windowSize, m_congestionControl->GetCongestionWindow ());
+  uint32_t quantum = m_config.maxPayloadSize + ReliableUdpHeader::MAX_DATA_HEADER_SIZE;
+  uint32_t inFlight = GetInFlight ();
+  it = m_streams.lower_bound (m_drrNext);
+  uint32_t idle = 0;
+  while (!paced && inFlight < window && idle < m_streams.size ()) {
+    if (it == m_streams.end ()) {
+      it = m_streams.begin ();
+    }
+    Stream &s = it->second;
+    if (!CanSend (s)) {
+      // An idle stream does not bank credit
+      s.deficit = 0;
+      m_drrCredited = false;
+      idle++;
+      ++it;
+      continue;
+    }
+    if (!m_drrCredited) {
+      s.deficit += s.weight * quantum;
+      m_drrCredited = true;
+    }
+    while (inFlight < window && CanSend (s)) {
+      uint32_t size = s.txQueue->Peek ()->GetSize ();
+      if (size > s.deficit) {
+        break;
+      }
+      if (!ConsumeTokens (size, rate)) {
+        paced = true;
+        break;
+      }
+      // The queued packet itself goes out; only its header is rewritten
+      Ptr<Packet> p = s.txQueue->Dequeue ();
+      s.deficit -= size;
+      p->RemoveHeader (header);
+      uint32_t payloadSize = p->GetSize ();
+      SendPacket (s, header, p, false);
+      if (header.IsParity ()) {
+        // Parity is never acked nor resent
+        m_fecParitySent++;
+        continue;
+      }
+      s.lastSentSeqNum = header.GetSeqNum ();
+      s.sentPackets++;
+      m_packetsSent++;
+      s.unAckedPackets.Insert (header, payloadSize, now);
+      ArmTimers (s, header.GetSeqNum (), *s.unAckedPackets.Get (header.GetSeqNum ()));
+      inFlight++;
+    }
+    if (paced || inFlight >= window) {
+      break;
+    }
+    if (!CanSend (s)) {
+      s.deficit = 0;
+    }
+    m_drrCredited = false;
+    idle = 0;
+    ++it;
+  }
+  if (it == m_streams.end ()) {
+    it = m_streams.begin ();
+  }
+  if (it != m_streams.end ()) {
+    m_drrNext = it->first;
+  }
+
+  for (it = m_streams.begin (); it != m_streams.end (); ++it) {
+    Stream &s = it->second;
+    if (m_config.reliabilityMode == ReliableUdpHeader::NACK_MODE
+        && s.unAckedPackets.GetNPackets () > 0 && !s.keepaliveEvent.IsRunning ()) {
+      s.keepaliveEvent = Simulator::Schedule (m_config.keepaliveInterval, &ReliableUdpSession::SendKeepalive, this, s.id);
+    }
+    if (s.txQueue->IsEmpty () || s.unAckedPackets.GetNPackets () > 0 || s.probeEvent.IsRunning ()) {
+      continue;
+    }
+    s.txQueue->Peek ()->PeekHeader (header);
+    if (!header.IsParity () && int32_t (header.GetSeqNum () - s.rwndEdge) >= 0) {
+      // No ack is on its way to reopen the window
+      s.probeEvent = Simulator::Schedule (s.probeInterval, &ReliableUdpSession::SendProbe, this, s.id);
+    }
+  }
+
+  UpdateOccupancy ();
+
+  if (paced) {
+    // Wake up as soon as the bucket is out of debt
+    ScheduleSend (rate.CalculateBytesTxTime (uint32_t (-m_tokens) + 1));
+  }
+}
+
+bool
+ReliableUdpSession::CanSend (Stream &s)
+{
+  if (s.txQueue->IsEmpty () || s.unAckedPackets.IsFull ()) {
+    return false;
+  }
+  ReliableUdpHeader header;
+  s.txQueue->Peek ()->PeekHeader (header);
+  return header.IsParity () || int32_t (header.GetSeqNum () - s.rwndEdge) < 0;
+}
+
+uint32_t
+ReliableUdpSession::GetInFlight (void) const
+{
+  uint32_t packets = 0;
+  for (std::map<uint16_t, Stream>::const_iterator it = m_streams.begin (); it != m_streams.end (); ++it) {
+    packets += it->second.unAckedPackets.GetNPackets ();
+  }
+  return packets;
+}
+
+void
+ReliableUdpSession::ScheduleSend (Time delay)
+{
+  if (m_sendEvent.IsRunning ()) {
+    if (Simulator::GetDelayLeft (m_sendEvent) <= delay) {
+      return;
+    }
+    Simulator::Cancel (m_sendEvent);
+  }
+  m_sendEvent = Simulator::Schedule (delay, &ReliableUdpSession::Send, this);
+}
+
+DataRate
+ReliableUdpSession::GetPacingRate (void) const
+{
+  if (m_config.pacingRate.GetBitRate () > 0) {
+    return m_config.pacingRate;
+  }
+  return m_congestionControl->GetPacingRate ();
+}
+
+bool
+ReliableUdpSession::ConsumeTokens (uint32_t size, DataRate rate)
+{
+  if (rate.GetBitRate () == 0) {
+    return true;
+  }
+  if (m_tokens < 0) {
+    return false;
+  }
+  m_tokens -= size;
+  return true;
+}
+
+void
+ReliableUdpSession::SendPacket (Stream &s, ReliableUdpHeader &header, Ptr<Packet> p, bool retransmit)
+{
+  header.SetStreamId (s.id);
+  header.SetRetransmit (retransmit);
+  header.SetForwardSeq (s.forwardSeq);
+  // Zero means no timestamp, so a send at a multiple of 2^32 us takes 1 
+  uint32_t timestamp = uint32_t (Simulator::Now ().GetMicroSeconds ());
+  header.SetTimestamp (timestamp == 0 ? 1 : timestamp);
+  p->AddHeader (header);
+  m_socket->SendTo (p, 0, m_peer);
+  s.lastSendTime = Simulator::Now ();
+  if (m_config.recorder != 0) {
+    uint8_t flags = header.GetFlags ();
+    ReliableUdpEventRecorder::EventType type = header.IsParity () ? ReliableUdpEventRecorder::TX_PARITY
+      : (flags & ReliableUdpHeader::FLAG_PROBE) ? ReliableUdpEventRecorder::TX_PROBE
+      : (flags & ReliableUdpHeader::FLAG_KEEPALIVE) ? ReliableUdpEventRecorder::TX_KEEPALIVE
+      : ReliableUdpEventRecorder::TX_DATA;
+    uint32_t seq = (flags & ReliableUdpHeader::FLAG_KEEPALIVE) ? header.GetNextSeq () : header.GetSeqNum ();
+    m_config.recorder->Record (type, s.id, seq, p->GetSize (),
+                               retransmit ? ReliableUdpEventRecorder::RETRANSMIT : 0);
+  }
+}
+
+void
+ReliableUdpSession::Retransmit (Stream &s, ReliableUdpRetransmissionBuffer::Entry &record)
+{
+  // Payloads are zero-filled, so the packet is rebuilt from its header
+  ReliableUdpHeader header;
+  record.GetHeader (header);
+  SendPacket (s, header, Create<Packet> (record.payloadSize), true);
+  m_packetsRetransmitted++;
+
+  NS_LOG_INFO ("Retransmit retry " << record.retries + 1);
+  record.sentTime = Simulator::Now ();
+  record.retries++;
+  record.lost = false;
+  record.timedOut = false;
+  ArmTimers (s, record.seq, record);
+}
+
+void
+ReliableUdpSession::ArmTimers (Stream &s, uint32_t seq, ReliableUdpRetransmissionBuffer::Entry &record)
+{
+  uint64_t key = (uint64_t (s.id) << 32) | seq;
+  if (m_config.reliabilityMode == ReliableUdpHeader::ACK_MODE) {
+    record.rtoTimer.SetFunction (&ReliableUdpSession::RtoExpired, this, key);
+    m_config.timerWheel->Schedule (record.rtoTimer, record.sentTime + m_rto.Get ());
+  }
+  if (record.retries == 0 && !record.deadline.IsZero ()) {
+    record.deadlineTimer.SetFunction (&ReliableUdpSession::DeadlineExpired, this, key);
+    m_config.timerWheel->Schedule (record.deadlineTimer, record.deadline);
+  }
+}
+
+void
+ReliableUdpSession::RtoExpired (void *session, uint64_t key)
+{
+  ReliableUdpSession *self = static_cast<ReliableUdpSession *> (session);
+  Stream &s = self->m_streams[uint16_t (key >> 32)];
+  uint32_t seq = uint32_t (key);
+  ReliableUdpRetransmissionBuffer::Entry *record = s.unAckedPackets.Get (seq);
+  NS_ASSERT (record != 0);
+  if (!record->lost) {
+    // A packet reported lost is queued already
+    s.repairs.push_back (seq);
+  }
+  record->timedOut = true;
+  self->ScheduleSend (Seconds (0));
+}
+
+void
+ReliableUdpSession::DeadlineExpired (void *session, uint64_t key)
+{
+  ReliableUdpSession *self = static_cast<ReliableUdpSession *> (session);
+  Stream &s = self->m_streams[uint16_t (key >> 32)];
+  self->Abandon (s, uint32_t (key));
+  self->UpdateOccupancy ();
+  // The window has room for one more
+  self->ScheduleSend (Seconds (0));
+}
+
+void
+ReliableUdpSession::Abandon (Stream &s, uint32_t seq)
+{
+  NS_LOG_INFO ("Abandon seq " << seq << " of stream " << s.id << " past its deadline");
+  s.unAckedPackets.Remove (seq);
+  if (int32_t (seq + 1 - s.forwardSeq) > 0) {
+    s.forwardSeq = seq + 1;
+  }
+  m_packetsDropped++;
+  if (m_config.recorder != 0) {
+    m_config.recorder->Record (ReliableUdpEventRecorder::ABANDON, s.id, seq, 0);
+  }
+}
+
+void
+ReliableUdpSession::HandleAck (Stream &s, uint32_t ackNum, uint32_t sackBitmap, uint32_t timestampEcho)
+{
+  // The client echoes timestamps of original transmissions only, and each 
+  // of them once, so every echo is an unambiguous sample (Karn's rule)
+  Time rtt;
+  if (timestampEcho != 0) {
+    rtt = MicroSeconds (uint32_t (uint32_t (Simulator::Now ().GetMicroSeconds ()) - timestampEcho));
+    UpdateRtt (rtt);
+  }
+
+  // The cumulative ack releases the head of the ring at once, then
+  // every SACKed packet is released by its slot.
+  ReliableUdpRetransmissionBuffer::AckedInfo info;
+  uint32_t highestAcked = ackNum - 1;
+  s.unAckedPackets.AckBelow (ackNum, info);
+  for (uint32_t i = 0; i < 32 && (sackBitmap >> i); i++) {
+    if ((sackBitmap & (1u << i)) && s.unAckedPackets.Ack (ackNum + 1 + i, info)) {
+      highestAcked = ackNum + 1 + i;
+    }
+  }
+  if (m_config.recorder != 0) {
+    m_config.recorder->Record (ReliableUdpEventRecorder::RX_ACK, s.id, ackNum, info.packets);
+  }
+  if (info.packets == 0) {
+    return;
+  }
+  // Everything below the head of the ring was acked or abandoned; keeping 
+  // the forward seq # there keeps it within the DATA section's delta
+  uint32_t base = s.unAckedPackets.GetBase ();
+  if (int32_t (base - s.forwardSeq) > 0) {
+    s.forwardSeq = base;
+  }
+  s.ackedBytes += info.bytes;
+  m_packetsAcked += info.packets;
+  m_bytesAcked += info.bytes;
+  UpdateOccupancy ();
+  m_congestionControl->OnAck (info.packets, info.bytes, GetInFlight (), rtt);
+  if (m_config.reliabilityMode == ReliableUdpHeader::ACK_MODE) {
+    DetectLosses (s, highestAcked, info.latestSentTime);
+  }
+  m_cWnd = m_congestionControl->GetCongestionWindow ();
+  // The window may have opened or losses may wait for a resend
+  ScheduleSend (Seconds (0));
+}
+
+void
+ReliableUdpSession::HandleNack (Stream &s, uint32_t base, uint64_t bitmap)
+{
+  Time now = Simulator::Now ();
+  uint32_t queued = 0;
+  bool newLossEvent = false;
+  for (uint32_t i = 0; i < 64 && (bitmap >> i); i++) {
+    if (!(bitmap & (uint64_t (1) << i))) {
+      continue;
+    }
+    uint32_t seq = base + i;
+    ReliableUdpRetransmissionBuffer::Entry *record = s.unAckedPackets.Get (seq);
+    // Acked or abandoned, queued already, or resent after the client asked
+    if (!record || record->lost || (record->retries > 0 && now - record->sentTime < m_srtt.Get ())) {
+      continue;
+    }
+    s.repairs.push_back (seq);
+    record->lost = true;
+    s.lostPackets++;
+    queued++;
+    if (m_config.recorder != 0) {
+      m_config.recorder->Record (ReliableUdpEventRecorder::LOSS, s.id, seq, record->size,
+                                 record->retries > 0 ? ReliableUdpEventRecorder::RETRANSMIT : 0);
+    }
+    newLossEvent = newLossEvent || record->sentTime > m_recoveryTime;
+  }
+  if (m_config.recorder != 0) {
+    m_config.recorder->Record (ReliableUdpEventRecorder::RX_NACK, s.id, base, queued);
+  }
+  if (newLossEvent) {
+    m_congestionControl->OnLoss (GetInFlight ());
+    m_recoveryTime = now;
+    m_cWnd = m_congestionControl->GetCongestionWindow ();
+  }
+  if (queued > 0) {
+    ScheduleSend (Seconds (0));
+  }
+}
+
+void
+ReliableUdpSession::SendKeepalive (uint16_t streamId)
+{
+  Stream &s = m_streams[streamId];
+  if (s.unAckedPackets.GetNPackets () == 0) {
+    return;
+  }
+  Time idle = Simulator::Now () - s.lastSendTime;
+  if (idle < m_config.keepaliveInterval) {
+    s.keepaliveEvent = Simulator::Schedule (m_config.keepaliveInterval - idle,
+                                            &ReliableUdpSession::SendKeepalive, this, streamId);
+    return;
+  }
+  NS_LOG_INFO ("Keepalive of stream " << s.id << " at seq " << s.lastSentSeqNum + 1);
+  ReliableUdpHeader header;
+  header.SetFlags (ReliableUdpHeader::FLAG_KEEPALIVE);
+  header.SetNextSeq (s.lastSentSeqNum + 1);
+  SendPacket (s, header, Create<Packet> (0), false);
+  s.keepaliveEvent = Simulator::Schedule (m_config.keepaliveInterval, &ReliableUdpSession::SendKeepalive, this, streamId);
+}
+
+void
+ReliableUdpSession::UpdateRtt (Time rtt)
+{
+  if (m_srtt.Get ().IsZero ()) {
+    m_srtt = rtt;
+    m_rttvar = Seconds (rtt.GetSeconds () / 2);
+  } else {
+    double err = std::fabs ((m_srtt.Get () - rtt).GetSeconds ());
+    m_rttvar = Seconds (0.75 * m_rttvar.Get ().GetSeconds () + 0.25 * err);
+    m_srtt = Seconds (0.875 * m_srtt.Get ().GetSeconds () + 0.125 * rtt.GetSeconds ());
+  }
+  Time rto = m_srtt.Get () + Seconds (4 * m_rttvar.Get ().GetSeconds ());
+  m_rto = std::min (std::max (rto, m_config.minRto), m_config.maxRto);
+}
+
+void
+ReliableUdpSession::UpdateReceiveWindow (Stream &s, uint32_t ackNum, uint32_t windowEdge)
+{
+  if (int32_t (ackNum - s.highestAckNum) < 0) {
+    return;
+  }
+  s.highestAckNum = ackNum;
+  bool opened = int32_t (windowEdge - s.rwndEdge) > 0;
+  s.rwndEdge = windowEdge;
+  if (opened) {
+    Simulator::Cancel (s.probeEvent);
+    s.probeInterval = m_rto;
+    ScheduleSend (Seconds (0));
+  }
+}
+
+void
+ReliableUdpSession::SendProbe (uint16_t streamId)
+{
+  Stream &s = m_streams[streamId];
+  NS_LOG_INFO ("Probe zero window of stream " << s.id << " at " << s.rwndEdge);
+  ReliableUdpHeader header;
+  header.SetFlags (ReliableUdpHeader::FLAG_PROBE);
+  SendPacket (s, header, Create<Packet> (0), false);
+
+  s.probeInterval = std::min (s.probeInterval + s.probeInterval, m_config.maxProbeInterval);
+  s.probeEvent = Simulator::Schedule (s.probeInterval, &ReliableUdpSession::SendProbe, this, streamId);
+}
+
+void
+ReliableUdpSession::EnqueueParity (Stream &s, std::vector<Ptr<Packet> > &parity)
+{
+  for (uint32_t i = 0; i < parity.size (); i++) {
+    if (!s.txQueue->Enqueue (parity[i])) {
+      NS_LOG_WARN ("TxQueue full, dropping FEC parity");
+      m_packetsDropped++;
+    }
+  }
+  parity.clear ();
+}
+
+void
+ReliableUdpSession::DetectLosses (Stream &s, uint32_t ackNum, Time sentTime)
+{
+  // Only the packets far enough behind the acked packet and
+  // transmitted before it can be declared lost.
+  bool newLossEvent = false;
+  for (uint32_t seq = s.unAckedPackets.GetBase ();
+       seq != s.unAckedPackets.GetEnd () && int32_t (ackNum - seq) >= int32_t (m_config.reorderThreshold); ++seq) {
+    ReliableUdpRetransmissionBuffer::Entry *record = s.unAckedPackets.Get (seq);
+    if (record && !record->lost && record->sentTime <= sentTime) {
+      if (!record->timedOut) {
+        s.repairs.push_back (seq);
+      }
+      record->lost = true;
+      s.lostPackets++;
+      if (m_config.recorder != 0) {
+        m_config.recorder->Record (ReliableUdpEventRecorder::LOSS, s.id, seq, record->size,
+                                   record->retries > 0 ? ReliableUdpEventRecorder::RETRANSMIT : 0);
+      }
+      newLossEvent = newLossEvent || record->sentTime > m_recoveryTime;
+    }
+  }
+  if (newLossEvent) {
+    m_congestionControl->OnLoss (GetInFlight ());
+    m_recoveryTime = Simulator::Now ();
+  }
+}
+
+void
+ReliableUdpSession::UpdateBitrate (Stream &s)
+{
+  double seconds = (Simulator::Now () - s.abrStart).GetSeconds ();
+  ReliableUdpAbr::Status status;
+  status.goodput = DataRate (uint64_t (s.ackedBytes * 8 / seconds));
+  status.lossRate = s.sentPackets > 0 ? double (s.lostPackets) / s.sentPackets : 0;
+  status.rtt = m_srtt.Get ();
+  status.bufferLevel = s.bufferLevel;
+
+  // The path capacity is what the controller paces at or what its window 
+  // carries per RTT; streams share it by weight. Without an RTT sample 
+  // the goodput is all there is to go on.
+  double capacity = m_congestionControl->GetPacingRate ().GetBitRate ();
+  if (capacity == 0 && !m_srtt.Get ().IsZero ()) {
+    capacity = m_congestionControl->GetCongestionWindow ()
+      * (m_config.maxPayloadSize + ReliableUdpHeader::MAX_DATA_HEADER_SIZE) * 8 / m_srtt.Get ().GetSeconds ();
+  }
+  uint32_t totalWeight = 0;
+  for (std::map<uint16_t, Stream>::iterator it = m_streams.begin (); it != m_streams.end (); ++it) {
+    totalWeight += it->second.weight;
+  }
+  status.throughput = capacity > 0
+    ? DataRate (uint64_t (capacity * s.weight / totalWeight))
+    : status.goodput;
+  s.ackedBytes = 0;
+  s.sentPackets = 0;
+  s.lostPackets = 0;
+
+  const std::vector<DataRate> &ladder = m_config.bitrateLadder;
+  uint32_t rung = std::min (s.abr->SelectRung (ladder, s.rung, status), uint32_t (ladder.size () - 1));
+  if (rung != s.rung && s.frameSource->SetBitrate (ladder[rung])) {
+    NS_LOG_INFO ("Stream " << s.id << " switches from " << ladder[s.rung] << " to " << ladder[rung]);
+    m_bitrateSwitchTrace (s.id, ladder[s.rung], ladder[rung]);
+    s.rung = rung;
+  }
+  s.abrStart = Simulator::Now ();
+}
+
+void
+ReliableUdpSession::UpdateOccupancy (void)
+{
+  uint32_t queued = 0;
+  for (std::map<uint16_t, Stream>::const_iterator it = m_streams.begin (); it != m_streams.end (); ++it) {
+    queued += it->second.txQueue->GetNPackets ();
+  }
+  m_txQueuePackets = queued;
+  m_rtxBufferPackets = GetInFlight ();
+}
+
+} // namespace ns3
@@ -0,0 +1,411 @@
+#ifndef RELIABLE_UDP_SESSION_H
+#define RELIABLE_UDP_SESSION_H
+
+#include "ns3/object.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+#include "ns3/address.h"
+#include "ns3/queue.h"
+#include "ns3/queue-size.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
+#include "ns3/type-id.h"
+#include "ns3/data-rate.h"
+#include "reliable-udp-header.h"
+#include "reliable-udp-retransmission-buffer.h"
+#include "reliable-udp-congestion-control.h"
+#include "reliable-udp-frame-source.h"
+#include "reliable-udp-fec.h"
+#include "reliable-udp-abr.h"
+#include "reliable-udp-event-recorder.h"
+#include "reliable-udp-timer-wheel.h"
+#include <deque>
+#include <map>
+
+namespace ns3 {
+
+class Socket;
+class Packet;
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Stream state of one client of a ReliableUdpServer.
+ *
+ * A session owns everything that belongs to one viewer. It carries one or 
+ * more streams, each with its own frame source, sequence space, TX queue, 
+ * retransmission buffer, FEC encoder and receive window, so a loss on one 
+ * stream never holds back another. The streams share the path, so the 
+ * congestion controller and the pacing bucket belong to the session, and 
+ * new packets are taken from the streams by weighted deficit round robin.
+ * With a bitrate ladder, an adaptive bitrate policy switches the encoding 
+ * bitrate of each stream from the acks of the client.
+ * In NACK_MODE the client acks only periodically and NACKs the gaps it 
+ * sees: packets are resent when NACKed rather than on SACKs and RTO 
+ * timers, and a keepalive announces the next seq # of a stream that went 
+ * idle with packets unacked, so that the client sees losses at its tail.
+ * The server creates one session per peer address and hands it the acks 
+ * of that peer.
+ */
+class ReliableUdpSession : public Object
+{
+public:
+  /// Server settings shared by all sessions
+  struct Config
+  {
+    uint32_t windowSize;          //!< Max # of packets in flight
+    uint32_t rtxBufferSize;       //!< Capacity of the retransmission buffer; 0 for twice windowSize
+    Time rto;                     //!< Retransmission timeout until the first RTT sample
+    Time minRto;                  //!< Lower bound of the retransmission timeout
+    Time maxRto;                  //!< Upper bound of the retransmission timeout
+    uint32_t reorderThreshold;    //!< Reordering tolerated before declaring loss
+    TypeId congestionControlTypeId; //!< Type of the congestion controller
+    DataRate pacingRate;          //!< Fixed pacing rate; 0 to use the controller's
+    uint32_t pacingBurst;         //!< Depth of the pacing bucket in bytes
+    uint32_t maxPayloadSize;      //!< Max payload of a fragment in bytes
+    Time playoutDelay;            //!< Deadline of a frame relative to its timestamp
+    QueueSize txQueueSize;        //!< Capacity of the TX queue
+    Time maxProbeInterval;        //!< Cap of the zero window probe interval
+    ReliableUdpFec::Mode fecMode; //!< FEC mode; NONE disables FEC
+    uint32_t fecBlockSize;        //!< Max data packets per FEC block (K)
+    uint32_t fecParityCount;      //!< Parity packets per FEC block (M)
+    std::vector<DataRate> bitrateLadder; //!< Encoding bitrates in increasing order; empty disables ABR
+    TypeId abrTypeId;             //!< Type of the adaptive bitrate policy
+    Time abrInterval;             //!< Time between bitrate decisions
+    Ptr<ReliableUdpEventRecorder> recorder; //!< Records events of the session; 0 for none
+    Ptr<ReliableUdpTimerWheel> timerWheel;  //!< Holds the retransmission and deadline timers; 0 for one of the session's own
+    ReliableUdpHeader::ReliabilityMode reliabilityMode; //!< How losses are found
+    Time keepaliveInterval;       //!< Idle time before a keepalive in NACK_MODE
+  };
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  ReliableUdpSession ();
+  virtual ~ReliableUdpSession ();
+
+  /**
+   * \brief Start streaming to a peer.
+   * \param socket socket of the server, shared by all sessions
+   * \param peer address of the client
+   * \param config settings of the server
+   */
+  void Start (Ptr<Socket> socket, const Address &peer, const Config &config);
+
+  /**
+   * \brief Start streaming frames of a source on a new stream.
+   * \param streamId id of the stream, unique within the session
+   * \param frameSource frames of the stream
+   * \param weight share of the stream in the deficit round robin
+   */
+  void AddStream (uint16_t streamId, Ptr<ReliableUdpFrameSource> frameSource, uint32_t weight);
+
+  /**
+   * \brief Stop streaming and cancel every pending event.
+   */
+  void Stop (void);
+
+  /**
+   * \brief Handle a packet of the peer: an ack, a probe answer or a hello.
+   * \param header header of the packet
+   */
+  void Receive (ReliableUdpHeader &header);
+
+  /**
+   * \return the address of the client
+   */
+  Address GetPeer (void) const;
+
+  /**
+   * \return the last time a packet of the client arrived
+   */
+  Time GetLastActivity (void) const;
+
+  /**
+   * \return bytes held by the session, including queued packets
+   */
+  uint32_t GetMemoryUsage (void) const;
+
+  /**
+   * TracedCallback signature for a bitrate switch.
+   * \param [in] streamId the stream switched
+   * \param [in] from bitrate before the switch
+   * \param [in] to bitrate after the switch
+   */
+  typedef void (* BitrateSwitchTracedCallback)(uint16_t streamId, DataRate from, DataRate to);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// One stream of the session, with its own sequence space
+  struct Stream
+  {
+    Stream ();
+
+    uint16_t id;                 //!< Stream # 
+    uint32_t weight;             //!< Quanta the stream gets per round 
+    uint32_t deficit;            //!< Bytes the stream may still send in this round 
+
+    Ptr<ReliableUdpFrameSource> frameSource; //!< Frames to stream 
+    ReliableUdpFrameSource::Frame nextFrame; //!< Frame GeneratePackets() sends next 
+    Time streamStart;            //!< Time the stream started 
+
+    uint32_t lastGeneratedSeqNum; //!< Sequence # of recently generated packet 
+    uint32_t lastSentSeqNum;     //!< Sequence # of recently sent packet 
+    Ptr<Queue<Packet> > txQueue; //!< Packets waiting to be transmitted 
+    // Packets sent but not acked. This acts as a retransmission buffer. 
+    // Why a ring? Insert, ack and lookup by sequence # are O(1), and its 
+    // memory is allocated once and bounded by rtxBufferSize. 
+    ReliableUdpRetransmissionBuffer unAckedPackets;
+    uint32_t forwardSeq;         //!< Every seq # below it was acked or abandoned 
+    std::deque<uint32_t> repairs; //!< Seq #s reported lost or timed out, in the order to resend them 
+    ReliableUdpFecEncoder fecEncoder; //!< Makes parity packets of generated data 
+
+    uint32_t rwndEdge;           //!< Receive window of the client: seq # it lets us send up to 
+    uint32_t highestAckNum;      //!< Highest cumulative ack # received 
+    Time probeInterval;          //!< Time to the next zero window probe 
+    EventId probeEvent;          //!< Event to send a zero window probe 
+    Time lastSendTime;           //!< Last time a packet of the stream was sent 
+    EventId keepaliveEvent;      //!< Event to send a keepalive in NACK_MODE 
+    EventId generatePacketEvent; //!< Event to call GeneratePackets() at the next frame 
+
+    Ptr<ReliableUdpAbr> abr;     //!< Bitrate policy; 0 without ABR 
+    uint32_t rung;               //!< Index of the current bitrate in the ladder 
+    uint64_t ackedBytes;         //!< Bytes acked in the current ABR interval 
+    uint32_t sentPackets;        //!< Packets sent in the current ABR interval 
+    uint32_t lostPackets;        //!< Packets lost in the current ABR interval 
+    Time bufferLevel;            //!< Play time buffered by the client, from its last ack 
+    Time abrStart;               //!< Start of the current ABR interval 
+  };
+
+  /**
+   * \brief Generate packets of the next frame of a stream and enqueue them.
+   * It is called at the timestamp of every frame of the stream. The frame
+   * is fragmented into packets of at most maxPayloadSize bytes, each carrying
+   * the frame id and its fragment index and count.
+   * lastGeneratedSeqNum of the stream should be managed here.
+   * \param streamId the stream
+   */
+  void GeneratePackets (uint16_t streamId);
+
+  /**
+   * \brief It transmits the appropriate packet according to the situation.
+   * Packets in the retransmission buffers are resent only when their RTO 
+   * expired or they were reported lost. New packets keep flowing as long
+   * as the sliding window has room; streams take turns by weighted deficit 
+   * round robin, and their packets are moved to their retransmission buffer.
+   * Departures are paced by a token bucket; Send() reschedules itself when
+   * the bucket runs dry, and the RTO timers of the packets or NACKs wake it up.
+   * Packets which cannot reach the client before their deadline are
+   * abandoned instead of resent, and the forward seq # tells the client
+   * to skip them.
+   * New packets are never sent beyond the receive window of their stream;
+   * a zero window is probed until it opens.
+   */
+  void Send (void);
+
+  /**
+   * \return whether the head of the TX queue of a stream may be sent now, 
+   * not counting the congestion window and pacing
+   * \param s the stream
+   */
+  bool CanSend (Stream &s);
+
+  /**
+   * \return packets in flight over all streams
+   */
+  uint32_t GetInFlight (void) const;
+
+  /**
+   * \brief Make sure Send() runs within the given delay.
+   * An already scheduled Send() is kept if it runs earlier.
+   * \param delay time from now
+   */
+  void ScheduleSend (Time delay);
+
+  /**
+   * \return the rate departures are paced at; 0 means not paced
+   */
+  DataRate GetPacingRate (void) const;
+
+  /**
+   * \brief Take tokens for one packet from the pacing bucket.
+   * The bucket may go into debt by one packet, so any burst size works.
+   * \param size packet size in bytes
+   * \param rate current pacing rate
+   * \return false if the packet has to wait
+   */
+  bool ConsumeTokens (uint32_t size, DataRate rate);
+
+  /**
+   * \brief Send a packet to the client.
+   * The header gets the retransmit flag, the current forward seq # and a
+   * timestamp, and is added to the payload, which is sent without a copy.
+   * \param s the stream of the packet
+   * \param header header of the packet; updated to what was sent
+   * \param p the payload, without a ReliableUdpHeader
+   * \param retransmit whether the packet was sent before
+   */
+  void SendPacket (Stream &s, ReliableUdpHeader &header, Ptr<Packet> p, bool retransmit);
+
+  /**
+   * \brief Resend a packet held in a retransmission buffer with the retransmit flag set.
+   * \param s the stream of the packet
+   * \param record the retransmission buffer entry of the packet
+   */
+  void Retransmit (Stream &s, ReliableUdpRetransmissionBuffer::Entry &record);
+
+  /**
+   * \brief Start the RTO timer of a packet just sent, and its deadline timer if it is new.
+   * In NACK_MODE the client reports losses, so packets get no RTO timer.
+   * \param s the stream of the packet
+   * \param seq sequence # of the packet
+   * \param record the retransmission buffer entry of the packet
+   */
+  void ArmTimers (Stream &s, uint32_t seq, ReliableUdpRetransmissionBuffer::Entry &record);
+
+  /**
+   * \brief Queue a packet whose RTO expired for a resend.
+   * \param session the session
+   * \param key stream id in the upper and sequence # in the lower 32 bits
+   */
+  static void RtoExpired (void *session, uint64_t key);
+
+  /**
+   * \brief Abandon a packet which reached its deadline unacked.
+   * \param session the session
+   * \param key stream id in the upper and sequence # in the lower 32 bits
+   */
+  static void DeadlineExpired (void *session, uint64_t key);
+
+  /**
+   * \brief Give up a packet and let the client skip it.
+   * \param s the stream of the packet
+   * \param seq sequence # of the packet
+   */
+  void Abandon (Stream &s, uint32_t seq);
+
+  /**
+   * \brief Remove every packet covered by an ack from the retransmission buffer.
+   * In ACK_MODE the SACKs also reveal losses.
+   * \param s the stream acked
+   * \param ackNum cumulative ack #; all packets below it were received
+   * \param sackBitmap selective acks of the 32 packets following ackNum
+   * \param timestampEcho timestamp echoed by the ack; zero if it gives no RTT sample
+   */
+  void HandleAck (Stream &s, uint32_t ackNum, uint32_t sackBitmap, uint32_t timestampEcho);
+
+  /**
+   * \brief Queue the packets NACKed by the client for a resend.
+   * A packet already queued, or resent less than an SRTT ago so that the 
+   * NACK crossed the retransmission, is not queued again. The congestion 
+   * controller is told once per window of losses.
+   * \param s the stream NACKed
+   * \param base sequence # of the first packet asked for
+   * \param bitmap bit i asks for the packet with sequence # (base + i)
+   */
+  void HandleNack (Stream &s, uint32_t base, uint64_t bitmap);
+
+  /**
+   * \brief Announce the next seq # of a stream idle for keepaliveInterval with packets unacked.
+   * It reschedules itself for the rest of the interval while packets are 
+   * sent, and stops once every packet is acked; Send() starts it again.
+   * \param streamId the stream
+   */
+  void SendKeepalive (uint16_t streamId);
+
+  /**
+   * \brief Take an RTT sample into SRTT, RTTVAR and the RTO as in RFC 6298.
+   * \param rtt the sample
+   */
+  void UpdateRtt (Time rtt);
+
+  /**
+   * \brief Take the receive window advertised by an ack.
+   * Acks reordered behind a newer one are ignored.
+   * \param s the stream acked
+   * \param ackNum cumulative ack # of the ack
+   * \param windowEdge sequence # the client lets the server send up to
+   */
+  void UpdateReceiveWindow (Stream &s, uint32_t ackNum, uint32_t windowEdge);
+
+  /**
+   * \brief Ask the client for the receive window of a stream while it is closed.
+   * The probe interval doubles up to maxProbeInterval, so a lost window
+   * update stalls the stream for a bounded time only.
+   * \param streamId the stream
+   */
+  void SendProbe (uint16_t streamId);
+
+  /**
+   * \brief Queue the parity packets made by the FEC encoder of a stream behind the data.
+   * \param s the stream
+   * \param parity parity packets, including their headers
+   */
+  void EnqueueParity (Stream &s, std::vector<Ptr<Packet> > &parity);
+
+  /**
+   * \brief Mark packets sent before an acked one as lost.
+   * A packet is considered lost if a packet sent after it was acked and
+   * its sequence # is at least reorderThreshold behind the acked one.
+   * The congestion controller is told once per window of losses.
+   * \param s the stream acked
+   * \param ackNum sequence # of the acked packet
+   * \param sentTime time the acked packet was last transmitted
+   */
+  void DetectLosses (Stream &s, uint32_t ackNum, Time sentTime);
+
+  /**
+   * \brief Let the bitrate policy of a stream pick its next bitrate.
+   * It is called by the first frame generated at least abrInterval after 
+   * the last call, with the throughput, loss rate, RTT and client buffer 
+   * level measured since then. Decisions need no timer of their own, so a 
+   * stream out of frames schedules nothing.
+   * \param s the stream
+   */
+  void UpdateBitrate (Stream &s);
+
+  /**
+   * \brief Update the TxQueue and RtxBuffer gauges from the streams.
+   */
+  void UpdateOccupancy (void);
+
+  Config m_config;             //!< Settings of the server
+  Ptr<Socket> m_socket;        //!< Socket of the server
+  Address m_peer;              //!< Address of the client
+  Time m_lastActivity;         //!< Last time a packet of the client arrived
+
+  std::map<uint16_t, Stream> m_streams; //!< Streams by id 
+  uint16_t m_drrNext;          //!< Stream the round robin visits next 
+  bool m_drrCredited;          //!< Whether m_drrNext already got its quantum in this round 
+
+  TracedValue<Time> m_srtt;    //!< Smoothed RTT; zero before the first sample
+  TracedValue<Time> m_rttvar;  //!< RTT variation
+  TracedValue<Time> m_rto;     //!< Retransmission timeout
+  TracedValue<uint32_t> m_fecParitySent; //!< Parity packets sent
+  TracedValue<uint32_t> m_packetsSent;   //!< Data packets sent for the first time
+  TracedValue<uint32_t> m_packetsRetransmitted; //!< Data packets sent again
+  TracedValue<uint32_t> m_packetsAcked;  //!< Data packets released by acks
+  TracedValue<uint64_t> m_bytesAcked;    //!< Bytes of the packets released by acks
+  TracedValue<uint32_t> m_packetsDropped; //!< Packets dropped by a full TX queue or abandoned past their deadline
+  TracedValue<uint32_t> m_txQueuePackets; //!< Packets in the TX queues of all streams
+  TracedValue<uint32_t> m_rtxBufferPackets; //!< Packets in the retransmission buffers of all streams
+  TracedCallback<uint16_t, DataRate, DataRate> m_bitrateSwitchTrace; //!< Fired when a stream switches bitrate
+
+  Ptr<ReliableUdpCongestionControl> m_congestionControl; //!< Congestion controller
+  Time m_recoveryTime;         //!< Losses of packets sent before it belong to a handled loss event
+  TracedValue<uint32_t> m_cWnd; //!< Congestion window of m_congestionControl
+
+  double m_tokens;             //!< Bytes that may be sent now; negative in debt
+  Time m_lastRefill;           //!< Last time tokens were added
+
+  EventId m_sendEvent;            //!< Event to call Send() when pacing or an RTO allows
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_SESSION_H */
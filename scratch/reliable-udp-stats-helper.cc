@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/callback.h"
+#include "ns3/node.h"
+#include "reliable-udp-stats-helper.h"
+#include "reliable-udp-server.h"
+#include "reliable-udp-client.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpStatsHelper");
+
+ReliableUdpStatsHelper::ReliableUdpStatsHelper ()
+  : m_interval (Seconds (1)),
+    m_start (Seconds (0)),
+    m_stop (Seconds (0)),
+    m_lastSample (Seconds (0))
+{
+}
+
+void
+ReliableUdpStatsHelper::SetInterval (Time interval)
+{
+  NS_ASSERT_MSG (interval.IsStrictlyPositive (), "Sampling interval must be positive");
+  m_interval = interval;
+}
+
+void
+ReliableUdpStatsHelper::Add (Ptr<Application> app)
+{
+  static const Metric s_serverMetrics[] = {
+    { "PacketsSent", false, false },
+    { "PacketsRetransmitted", false, false },
+    { "PacketsAcked", false, false },
+    { "BytesAcked", true, false },
+    { "PacketsDropped", false, false },
+    { "Sessions", false, true },
+    { "TxQueue", false, true },
+    { "RtxBuffer", false, true },
+  };
+
+  static const Metric s_clientMetrics[] = {
+    { "PacketsReceived", false, false },
+    { "Duplicates", false, false },
+    { "Reordered", false, false },
+    { "PacketsDropped", false, false },
+    { "BytesDelivered", true, false },
+    { "FecRecovered", false, false },
+    { "LateFrames", false, false },
+    { "Rebuffering", false, false },
+    { "ReorderBuffer", false, true },
+    { "InOrderQueue", false, true },
+  };
+
+  Record record;
+  std::ostringstream name;
+  if (DynamicCast<ReliableUdpServer> (app) != 0) {
+    record.server = true;
+    record.metrics = s_serverMetrics;
+    record.nMetrics = sizeof (s_serverMetrics) / sizeof (s_serverMetrics[0]);
+    name << "server/";
+  } else if (DynamicCast<ReliableUdpClient> (app) != 0) {
+    record.server = false;
+    record.metrics = s_clientMetrics;
+    record.nMetrics = sizeof (s_clientMetrics) / sizeof (s_clientMetrics[0]);
+    name << "client/";
+  } else {
+    NS_LOG_WARN ("Application is neither a ReliableUdpServer nor a ReliableUdpClient; ignored");
+    return;
+  }
+  // Several clients may share a node; the index of the application tells them apart
+  Ptr<Node> node = app->GetNode ();
+  uint32_t index = 0;
+  while (index < node->GetNApplications () && node->GetApplication (index) != app) {
+    index++;
+  }
+  name << node->GetId () << "/" << index;
+  record.name = name.str ();
+  Traced zero = { 0, 0 };
+  record.traced.resize (record.nMetrics, zero);
+  record.sampled.resize (record.nMetrics, 0);
+  record.peaks.resize (record.nMetrics, 0);
+  m_records.push_back (record);
+
+  // Traces write straight into the record, which stays where it is in the list
+  Record &added = m_records.back ();
+  for (uint32_t i = 0; i < added.nMetrics; i++) {
+    bool connected = added.metrics[i].wide
+      ? app->TraceConnectWithoutContext (added.metrics[i].name,
+                                         MakeBoundCallback (&ReliableUdpStatsHelper::Update<uint64_t>, &added.traced[i]))
+      : app->TraceConnectWithoutContext (added.metrics[i].name,
+                                         MakeBoundCallback (&ReliableUdpStatsHelper::Update<uint32_t>, &added.traced[i]));
+    NS_ASSERT_MSG (connected, "No trace source " << added.metrics[i].name << " on " << added.name);
+  }
+}
+
+void
+ReliableUdpStatsHelper::Add (ApplicationContainer apps)
+{
+  for (ApplicationContainer::Iterator i = apps.Begin (); i != apps.End (); ++i) {
+    Add (*i);
+  }
+}
+
+void
+ReliableUdpStatsHelper::Start (Time start)
+{
+  m_start = start;
+  Simulator::Cancel (m_sampleEvent);
+  m_sampleEvent = Simulator::Schedule (start - Simulator::Now (), &ReliableUdpStatsHelper::TakeSample, this);
+}
+
+void
+ReliableUdpStatsHelper::Stop (Time stop)
+{
+  m_stop = stop;
+}
+
+void
+ReliableUdpStatsHelper::TakeSample (void)
+{
+  Time now = Simulator::Now ();
+  m_lastSample = now;
+  for (std::list<Record>::iterator it = m_records.begin (); it != m_records.end (); ++it) {
+    Record &record = *it;
+    for (uint32_t i = 0; i < record.nMetrics; i++) {
+      // Peaks between samples count from the first sample on 
+      Traced &traced = record.traced[i];
+      record.sampled[i] = traced.value;
+      record.peaks[i] = std::max (record.peaks[i], now > m_start ? traced.high : traced.value);
+      traced.high = traced.value;
+    }
+    Sample sample;
+    sample.time = now;
+    sample.record = &record;
+    sample.values = record.sampled;
+    m_samples.push_back (sample);
+  }
+
+  if (!m_stop.IsZero () && now >= m_stop) {
+    return;
+  }
+  Time next = now + m_interval;
+  if (!m_stop.IsZero () && next > m_stop) {
+    next = m_stop;
+  }
+  m_sampleEvent = Simulator::Schedule (next - now, &ReliableUdpStatsHelper::TakeSample, this);
+}
+
+uint64_t
+ReliableUdpStatsHelper::GetLast (const Record &record, const std::string &name) const
+{
+  for (uint32_t i = 0; i < record.nMetrics; i++) {
+    if (name == record.metrics[i].name) {
+      return record.sampled[i];
+    }
+  }
+  NS_FATAL_ERROR ("No metric " << name << " on " << record.name);
+  return 0;
+}
+
+void
+ReliableUdpStatsHelper::WriteCsv (std::string filename) const
+{
+  std::ofstream out (filename.c_str ());
+  if (!out) {
+    NS_FATAL_ERROR ("Cannot open " << filename);
+  }
+  out << "time,app,metric,value" << std::endl;
+  for (std::vector<Sample>::const_iterator it = m_samples.begin (); it != m_samples.end (); ++it) {
+    const Record &record = *it->record;
+    for (uint32_t i = 0; i < record.nMetrics; i++) {
+      out << it->time.GetSeconds () << "," << record.name << ","
+          << record.metrics[i].name << "," << it->values[i] << "\n";
+    }
+  }
+}
+
+void
+ReliableUdpStatsHelper::WriteJson (std::string filename) const
+{
+  std::ofstream out (filename.c_str ());
+  if (!out) {
+    NS_FATAL_ERROR ("Cannot open " << filename);
+  }
+  double duration = (m_lastSample - m_start).GetSeconds ();
+  out << "{\n  \"duration\": " << duration << ",\n  \"applications\": [";
+  for (std::list<Record>::const_iterator it = m_records.begin (); it != m_records.end (); ++it) {
+    const Record &record = *it;
+    out << (it == m_records.begin () ? "\n" : ",\n")
+        << "    {\n      \"name\": \"" << record.name << "\",\n"
+        << "      \"type\": \"" << (record.server ? "server" : "client") << "\"";
+    for (uint32_t i = 0; i < record.nMetrics; i++) {
+      // Counters as of the last sample, gauges at their peak
+      out << ",\n      \"" << record.metrics[i].name << (record.metrics[i].gauge ? "Peak" : "")
+          << "\": " << (record.metrics[i].gauge ? record.peaks[i] : record.sampled[i]);
+    }
+    // The server counts what the clients acked, headers included, and the
+    // clients what they delivered in order, payload only
+    uint64_t bytes = GetLast (record, record.server ? "BytesAcked" : "BytesDelivered");
+    out << ",\n      \"goodput\": " << (duration > 0 ? bytes * 8 / duration : 0);
+    if (record.server) {
+      uint64_t sent = GetLast (record, "PacketsSent");
+      uint64_t resent = GetLast (record, "PacketsRetransmitted");
+      out << ",\n      \"retransmissionRatio\": " << (sent > 0 ? double (resent) / sent : 0);
+    } else {
+      uint64_t received = GetLast (record, "PacketsReceived");
+      uint64_t duplicates = GetLast (record, "Duplicates");
+      out << ",\n      \"duplicateRatio\": " << (received > 0 ? double (duplicates) / received : 0);
+    }
+    out << "\n    }";
+  }
+  out << "\n  ]\n}" << std::endl;
+}
+
+} // namespace ns3
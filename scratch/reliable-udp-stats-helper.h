@@ -0,0 +1,148 @@
+#ifndef RELIABLE_UDP_STATS_HELPER_H
+#define RELIABLE_UDP_STATS_HELPER_H
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <vector>
+#include "ns3/application-container.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ * \brief Sample the counters and gauges of ReliableUdpServer and ReliableUdpClient
+ * applications and write them out.
+
+ * The helper connects to the trace sources of each application added, so
+ * it has to outlive the simulation. Every interval it takes a sample of
+ * all of them; WriteCsv() writes the samples and WriteJson() a summary of
+ * the run with the final counters, the peak of every gauge, the goodput
+ * and the retransmission ratio.
+ */
+class ReliableUdpStatsHelper
+{
+public:
+  ReliableUdpStatsHelper ();
+
+  /**
+   * \brief Set the time between samples; one second by default.
+   * \param interval time between samples
+   */
+  void SetInterval (Time interval);
+
+  /**
+   * \brief Watch a ReliableUdpServer or a ReliableUdpClient.
+   * \param app the application
+   */
+  void Add (Ptr<Application> app);
+
+  /**
+   * \brief Watch every ReliableUdpServer and ReliableUdpClient of a container.
+   * \param apps the applications
+   */
+  void Add (ApplicationContainer apps);
+
+  /**
+   * \brief Take the first sample at a time, and one every interval after it.
+   * Goodputs are measured from this time.
+   * \param start time of the first sample
+   */
+  void Start (Time start);
+
+  /**
+   * \brief Take the last sample at a time.
+   * \param stop time of the last sample
+   */
+  void Stop (Time stop);
+
+  /**
+   * \brief Write every sample as a "time,app,metric,value" line.
+   * \param filename the CSV file
+   */
+  void WriteCsv (std::string filename) const;
+
+  /**
+   * \brief Write the summary of the run as of the last sample.
+   * \param filename the JSON file
+   */
+  void WriteJson (std::string filename) const;
+
+private:
+  /// A trace source sampled by the helper
+  struct Metric
+  {
+    const char *name; //!< Name of the trace source
+    bool wide;        //!< Whether it is a TracedValue<uint64_t>
+    bool gauge;       //!< Whether it goes down as well as up
+  };
+
+  /// A metric as the traces keep it
+  struct Traced
+  {
+    uint64_t value;   //!< Current value
+    uint64_t high;    //!< Highest value since the latest sample
+  };
+
+  /// An application and its metrics
+  struct Record
+  {
+    std::string name;    //!< "server/" or "client/", the node id, "/" and the index of the application on its node
+    bool server;         //!< Whether it is a ReliableUdpServer
+    const Metric *metrics; //!< Its metrics
+    uint32_t nMetrics;   //!< Number of metrics
+    std::vector<Traced> traced;   //!< Every metric, kept by the traces
+    std::vector<uint64_t> sampled; //!< Value of every metric in the latest sample
+    std::vector<uint64_t> peaks;  //!< Highest value of every metric since the first sample
+  };
+
+  /// Values of all metrics of an application at a time
+  struct Sample
+  {
+    Time time;             //!< Time of the sample
+    const Record *record;  //!< The application
+    std::vector<uint64_t> values; //!< Value of every metric of the record
+  };
+
+  /**
+   * \brief Sample every application and schedule the next sample.
+   */
+  void TakeSample (void);
+
+  /**
+   * \brief Keep the new value of a trace source, and its peak between samples.
+   * \param traced where the helper keeps it
+   * \param oldValue value before the change
+   * \param newValue value after the change
+   */
+  template <typename T>
+  static void Update (Traced *traced, T oldValue, T newValue)
+  {
+    traced->value = newValue;
+    if (traced->value > traced->high) {
+      traced->high = traced->value;
+    }
+  }
+
+  /**
+   * \param record an application
+   * \param name name of one of its metrics
+   * \return the value of the metric in the latest sample
+   */
+  uint64_t GetLast (const Record &record, const std::string &name) const;
+
+  std::list<Record> m_records;  //!< Applications; a list keeps the values traced into in place
+  std::vector<Sample> m_samples; //!< Samples in time order
+  Time m_interval;  //!< Time between samples
+  Time m_start;     //!< Time of the first sample
+  Time m_stop;      //!< Time of the last sample; zero to sample until the simulation ends
+  Time m_lastSample; //!< Time of the latest sample
+  EventId m_sampleEvent; //!< Event to take the next sample
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_STATS_HELPER_H */
@@ -0,0 +1,223 @@
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "reliable-udp-timer-wheel.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpTimerWheel");
+
+ReliableUdpTimer::ReliableUdpTimer ()
+  : m_prev (0),
+    m_next (0),
+    m_wheel (0),
+    m_expiry (0),
+    m_function (0),
+    m_context (0),
+    m_argument (0)
+{
+}
+
+ReliableUdpTimer::ReliableUdpTimer (const ReliableUdpTimer &other)
+  : m_prev (0),
+    m_next (0),
+    m_wheel (0),
+    m_expiry (0),
+    m_function (other.m_function),
+    m_context (other.m_context),
+    m_argument (other.m_argument)
+{
+}
+
+ReliableUdpTimer::~ReliableUdpTimer ()
+{
+  Cancel ();
+}
+
+ReliableUdpTimer &
+ReliableUdpTimer::operator= (const ReliableUdpTimer &other)
+{
+  if (this != &other) {
+    Cancel ();
+    m_function = other.m_function;
+    m_context = other.m_context;
+    m_argument = other.m_argument;
+  }
+  return *this;
+}
+
+void
+ReliableUdpTimer::SetFunction (Function function, void *context, uint64_t argument)
+{
+  m_function = function;
+  m_context = context;
+  m_argument = argument;
+}
+
+void
+ReliableUdpTimer::Cancel (void)
+{
+  if (m_prev == 0) {
+    return;
+  }
+  m_prev->m_next = m_next;
+  m_next->m_prev = m_prev;
+  m_prev = m_next = 0;
+  m_wheel->m_nTimers--;
+  m_wheel = 0;
+}
+
+bool
+ReliableUdpTimer::IsRunning (void) const
+{
+  return m_prev != 0;
+}
+
+ReliableUdpTimerWheel::ReliableUdpTimerWheel (Time granularity)
+  : m_granularity (granularity),
+    m_current (0),
+    m_nTimers (0)
+{
+  NS_ASSERT_MSG (granularity.IsStrictlyPositive (), "Tick of a timer wheel must be positive");
+  // Every slot is a sentinel of an empty circular list
+  for (uint32_t level = 0; level < LEVELS; level++) {
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      m_slots[level][i].m_prev = m_slots[level][i].m_next = &m_slots[level][i];
+    }
+  }
+}
+
+ReliableUdpTimerWheel::~ReliableUdpTimerWheel ()
+{
+  Clear ();
+  // Sentinels are not timers; unlink them so that they do not cancel themselves
+  for (uint32_t level = 0; level < LEVELS; level++) {
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      m_slots[level][i].m_prev = m_slots[level][i].m_next = 0;
+    }
+  }
+}
+
+void
+ReliableUdpTimerWheel::Schedule (ReliableUdpTimer &timer, Time expiry)
+{
+  NS_ASSERT (timer.m_function != 0);
+  timer.Cancel ();
+  if (!m_tickEvent.IsRunning ()) {
+    // Idle wheels do not tick; catch up with the clock before counting from it
+    m_current = Simulator::Now ().GetTimeStep () / m_granularity.GetTimeStep ();
+  }
+  // Round up so that no timer expires early
+  int64_t step = m_granularity.GetTimeStep ();
+  int64_t at = expiry.GetTimeStep ();
+  uint64_t tick = at <= 0 ? 0 : uint64_t ((at + step - 1) / step);
+  timer.m_expiry = std::max (tick, m_current + 1);
+  timer.m_wheel = this;
+  Place (timer);
+  m_nTimers++;
+  if (!m_tickEvent.IsRunning ()) {
+    Time next = TimeStep ((m_current + 1) * step) - Simulator::Now ();
+    m_tickEvent = Simulator::Schedule (next, &ReliableUdpTimerWheel::Tick, this);
+  }
+}
+
+void
+ReliableUdpTimerWheel::Clear (void)
+{
+  for (uint32_t level = 0; level < LEVELS; level++) {
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      ReliableUdpTimer &head = m_slots[level][i];
+      while (head.m_next != &head) {
+        head.m_next->Cancel ();
+      }
+    }
+  }
+  Simulator::Cancel (m_tickEvent);
+}
+
+uint32_t
+ReliableUdpTimerWheel::GetNTimers (void) const
+{
+  return m_nTimers;
+}
+
+Time
+ReliableUdpTimerWheel::GetGranularity (void) const
+{
+  return m_granularity;
+}
+
+void
+ReliableUdpTimerWheel::Place (ReliableUdpTimer &timer)
+{
+  uint64_t delta = timer.m_expiry - m_current;
+  uint32_t level = 0;
+  while (level + 1 < LEVELS && delta >= (uint64_t (1) << (SLOT_BITS * (level + 1)))) {
+    level++;
+  }
+  if (level == LEVELS - 1 && delta >= (uint64_t (1) << (SLOT_BITS * LEVELS))) {
+    // Beyond the span of the wheel; park it at the far end and let cascades bring it closer
+    timer.m_expiry = m_current + (uint64_t (1) << (SLOT_BITS * LEVELS)) - 1;
+    NS_LOG_WARN ("Timer beyond the span of the wheel expires early");
+  }
+  ReliableUdpTimer &head = m_slots[level][(timer.m_expiry >> (SLOT_BITS * level)) & (SLOTS - 1)];
+  timer.m_next = &head;
+  timer.m_prev = head.m_prev;
+  head.m_prev->m_next = &timer;
+  head.m_prev = &timer;
+}
+
+void
+ReliableUdpTimerWheel::Cascade (uint32_t level, uint32_t index)
+{
+  ReliableUdpTimer &head = m_slots[level][index];
+  while (head.m_next != &head) {
+    ReliableUdpTimer &timer = *head.m_next;
+    timer.m_prev->m_next = timer.m_next;
+    timer.m_next->m_prev = timer.m_prev;
+    Place (timer);
+  }
+}
+
+uint32_t
+ReliableUdpTimerWheel::Index (uint32_t level) const
+{
+  return (m_current >> (SLOT_BITS * level)) & (SLOTS - 1);
+}
+
+void
+ReliableUdpTimerWheel::Tick (void)
+{
+  m_current++;
+  // Level 0 wrapped around: bring down the timers of the next 256 ticks,
+  // and from further up when the level above wrapped as well
+  for (uint32_t level = 1; level < LEVELS && Index (level - 1) == 0; level++) {
+    Cascade (level, Index (level));
+  }
+
+  // Move the due timers aside first, so that expiring one may cancel or
+  // schedule others, this tick's included
+  ReliableUdpTimer due;
+  due.m_prev = due.m_next = &due;
+  ReliableUdpTimer &head = m_slots[0][Index (0)];
+  if (head.m_next != &head) {
+    due.m_next = head.m_next;
+    due.m_prev = head.m_prev;
+    due.m_next->m_prev = &due;
+    due.m_prev->m_next = &due;
+    head.m_next = head.m_prev = &head;
+  }
+  while (due.m_next != &due) {
+    ReliableUdpTimer &timer = *due.m_next;
+    timer.Cancel ();
+    timer.m_function (timer.m_context, timer.m_argument);
+  }
+  due.m_prev = due.m_next = 0;
+
+  // A timer scheduled by one of the functions above has already scheduled the next tick
+  if (m_nTimers > 0 && !m_tickEvent.IsRunning ()) {
+    m_tickEvent = Simulator::Schedule (m_granularity, &ReliableUdpTimerWheel::Tick, this);
+  }
+}
+
+} // namespace ns3
@@ -0,0 +1,165 @@
+#ifndef RELIABLE_UDP_TIMER_WHEEL_H
+#define RELIABLE_UDP_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+class ReliableUdpTimerWheel;
+
+/**
+ * \ingroup reliableudpserver
+ * \brief A timer held by a ReliableUdpTimerWheel.
+ *
+ * The timer is a node of an intrusive list, so it is embedded in what it
+ * times, e.g. a retransmission buffer entry, and scheduling or cancelling
+ * it allocates nothing. A timer cancels itself when it is destroyed; a
+ * copy starts out not scheduled.
+ */
+class ReliableUdpTimer
+{
+public:
+  /**
+   * Function called when the timer expires.
+   * \param context the context given to SetFunction()
+   * \param argument the argument given to SetFunction()
+   */
+  typedef void (* Function)(void *context, uint64_t argument);
+
+  ReliableUdpTimer ();
+  /**
+   * \brief Make a timer with the function of another one, not scheduled.
+   * \param other the timer
+   */
+  ReliableUdpTimer (const ReliableUdpTimer &other);
+  ~ReliableUdpTimer ();
+
+  /**
+   * \brief Cancel the timer and take the function of another one.
+   * \param other the timer
+   * \return this timer
+   */
+  ReliableUdpTimer &operator= (const ReliableUdpTimer &other);
+
+  /**
+   * \brief Set what the timer calls when it expires.
+   * \param function the function
+   * \param context first argument of the function, e.g. the object owning the timer
+   * \param argument second argument of the function, e.g. what is timed
+   */
+  void SetFunction (Function function, void *context, uint64_t argument);
+
+  /**
+   * \brief Unschedule the timer if it is scheduled. O(1).
+   */
+  void Cancel (void);
+
+  /**
+   * \return whether the timer is scheduled
+   */
+  bool IsRunning (void) const;
+
+private:
+  friend class ReliableUdpTimerWheel;
+
+  ReliableUdpTimer *m_prev;  //!< Previous node of the list it is in; 0 if not scheduled
+  ReliableUdpTimer *m_next;  //!< Next node of the list it is in
+  ReliableUdpTimerWheel *m_wheel; //!< Wheel it is scheduled in
+  uint64_t m_expiry;         //!< Tick it expires at
+  Function m_function;       //!< Called on expiry
+  void *m_context;           //!< First argument of m_function
+  uint64_t m_argument;       //!< Second argument of m_function
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Hierarchical timing wheel holding the timers of an application.
+ *
+ * Time is divided into ticks of a fixed granularity. Level 0 has a slot per
+ * tick for the next 256 ticks, and each of the 3 levels above it a slot per
+ * 256 slots of the level below, so the wheel spans 2^32 ticks. A timer is
+ * linked into the slot of its expiry tick at the lowest level which reaches
+ * it, and timers of a higher level slot are moved down when level 0 wraps
+ * around to it. Schedule and cancel are O(1) and each timer is moved at
+ * most 3 times.
+ *
+ * One simulator event per tick drives the wheel, and only while it holds
+ * timers, so the simulator sees one event per tick however many timers
+ * are pending. Timers expire at the end of the tick of their expiry time,
+ * that is at most one granularity late and never early.
+ */
+class ReliableUdpTimerWheel : public SimpleRefCount<ReliableUdpTimerWheel>
+{
+public:
+  /**
+   * \param granularity duration of a tick
+   */
+  ReliableUdpTimerWheel (Time granularity);
+  ~ReliableUdpTimerWheel ();
+
+  /**
+   * \brief Schedule a timer, rescheduling it if it is already scheduled.
+   * \param timer the timer, with its function set
+   * \param expiry time it expires at; a past time expires at the next tick
+   */
+  void Schedule (ReliableUdpTimer &timer, Time expiry);
+
+  /**
+   * \brief Cancel every timer and stop ticking.
+   */
+  void Clear (void);
+
+  /**
+   * \return number of scheduled timers
+   */
+  uint32_t GetNTimers (void) const;
+
+  /**
+   * \return duration of a tick
+   */
+  Time GetGranularity (void) const;
+
+private:
+  friend class ReliableUdpTimer;
+
+  static const uint32_t LEVELS = 4;      //!< Number of levels
+  static const uint32_t SLOT_BITS = 8;   //!< log2 of the slots per level
+  static const uint32_t SLOTS = 1u << SLOT_BITS; //!< Slots per level
+
+  /**
+   * \brief Link a timer into the slot of its expiry.
+   * \param timer the timer, not scheduled
+   */
+  void Place (ReliableUdpTimer &timer);
+
+  /**
+   * \brief Move the timers of a slot of a level down to the levels below.
+   * \param level the level
+   * \param index the slot
+   */
+  void Cascade (uint32_t level, uint32_t index);
+
+  /**
+   * \brief Advance by one tick and expire the timers of the tick.
+   */
+  void Tick (void);
+
+  /**
+   * \param level a level
+   * \return index of the current tick in the level
+   */
+  uint32_t Index (uint32_t level) const;
+
+  Time m_granularity;  //!< Duration of a tick
+  uint64_t m_current;  //!< Last tick processed
+  uint32_t m_nTimers;  //!< Number of scheduled timers
+  EventId m_tickEvent; //!< Event to call Tick(); not running while empty
+  ReliableUdpTimer m_slots[LEVELS][SLOTS]; //!< Sentinels of the circular lists of each slot
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_TIMER_WHEEL_H */
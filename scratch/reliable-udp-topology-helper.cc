@@ -0,0 +1,217 @@
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/bulk-send-helper.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+#include "reliable-udp-server.h"
+#include "reliable-udp-topology-helper.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReliableUdpTopologyHelper");
+
+ReliableUdpDumbbellHelper::ReliableUdpDumbbellHelper (uint32_t nPairs, uint32_t nCrossFlows,
+                                                      PointToPointHelper accessLink,
+                                                      PointToPointHelper bottleneckLink)
+  : m_dumbbell (nPairs + nCrossFlows, accessLink, nPairs + nCrossFlows, accessLink, bottleneckLink),
+    m_nPairs (nPairs),
+    m_nCrossFlows (nCrossFlows)
+{
+  NS_ASSERT_MSG (nPairs > 0, "A dumbbell needs at least one server/client pair");
+  InternetStackHelper stack;
+  m_dumbbell.InstallStack (stack);
+  // Each leaf link takes the next /24 of its side
+  m_dumbbell.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.0.0", "255.255.255.0"),
+                                  Ipv4AddressHelper ("10.2.0.0", "255.255.255.0"),
+                                  Ipv4AddressHelper ("10.3.0.0", "255.255.255.0"));
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+}
+
+ApplicationContainer
+ReliableUdpDumbbellHelper::InstallServers (ReliableUdpServerHelper &server)
+{
+  ApplicationContainer apps;
+  for (uint32_t i = 0; i < m_nPairs; i++) {
+    apps.Add (server.Install (m_dumbbell.GetLeft (i)));
+  }
+  return apps;
+}
+
+ApplicationContainer
+ReliableUdpDumbbellHelper::InstallClients (ReliableUdpClientHelper &client, uint16_t port)
+{
+  ApplicationContainer apps;
+  client.SetAttribute ("RemotePort", UintegerValue (port));
+  for (uint32_t i = 0; i < m_nPairs; i++) {
+    client.SetAttribute ("RemoteAddress", AddressValue (m_dumbbell.GetLeftIpv4Address (i)));
+    apps.Add (client.Install (m_dumbbell.GetRight (i)));
+  }
+  return apps;
+}
+
+ApplicationContainer
+ReliableUdpDumbbellHelper::InstallCrossTraffic (uint16_t port, Time start, Time stop)
+{
+  ApplicationContainer sinks;
+  PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  for (uint32_t i = m_nPairs; i < m_nPairs + m_nCrossFlows; i++) {
+    BulkSendHelper sender ("ns3::TcpSocketFactory", InetSocketAddress (m_dumbbell.GetRightIpv4Address (i), port));
+    sender.SetAttribute ("MaxBytes", UintegerValue (0));
+    ApplicationContainer senders = sender.Install (m_dumbbell.GetLeft (i));
+    senders.Start (start);
+    senders.Stop (stop);
+    sinks.Add (sink.Install (m_dumbbell.GetRight (i)));
+  }
+  sinks.Start (Seconds (0));
+  return sinks;
+}
+
+const PointToPointDumbbellHelper &
+ReliableUdpDumbbellHelper::GetDumbbell (void) const
+{
+  return m_dumbbell;
+}
+
+ReliableUdpStarHelper::ReliableUdpStarHelper (uint32_t nClients, PointToPointHelper spokeLink)
+  : m_star (nClients, spokeLink)
+{
+  NS_ASSERT_MSG (nClients > 0, "A star needs at least one client");
+  InternetStackHelper stack;
+  m_star.InstallStack (stack);
+  m_star.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.0.0", "255.255.255.0"));
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+}
+
+ApplicationContainer
+ReliableUdpStarHelper::InstallServer (ReliableUdpServerHelper &server)
+{
+  return server.Install (m_star.GetHub ());
+}
+
+ApplicationContainer
+ReliableUdpStarHelper::InstallClients (ReliableUdpClientHelper &client, uint16_t port)
+{
+  ApplicationContainer apps;
+  client.SetAttribute ("RemotePort", UintegerValue (port));
+  for (uint32_t i = 0; i < m_star.SpokeCount (); i++) {
+    client.SetAttribute ("RemoteAddress", AddressValue (m_star.GetHubIpv4Address (i)));
+    apps.Add (client.Install (m_star.GetSpokeNode (i)));
+  }
+  return apps;
+}
+
+const PointToPointStarHelper &
+ReliableUdpStarHelper::GetStar (void) const
+{
+  return m_star;
+}
+
+ReliableUdpRegionsHelper::ReliableUdpRegionsHelper (uint32_t nRegions, uint32_t nClients,
+                                                    PointToPointHelper accessLink,
+                                                    PointToPointHelper coreLink,
+                                                    uint32_t nSystems, uint32_t systemId)
+  : m_serverApps (nRegions),
+    m_systemId (systemId)
+{
+  NS_ASSERT_MSG (nRegions > 0, "Regions need at least one region");
+  NS_ASSERT_MSG (nSystems > 0 && systemId < nSystems, "System " << systemId << " is not one of " << nSystems);
+  m_core = CreateObject<Node> (0);
+  for (uint32_t r = 0; r < nRegions; r++) {
+    m_routers.Add (CreateObject<Node> (r % nSystems));
+    m_servers.Add (CreateObject<Node> (r % nSystems));
+  }
+  for (uint32_t i = 0; i < nClients; i++) {
+    m_clients.Add (CreateObject<Node> ((i % nRegions) % nSystems));
+  }
+  InternetStackHelper stack;
+  stack.Install (m_core);
+  stack.Install (m_routers);
+  stack.Install (m_servers);
+  stack.Install (m_clients);
+
+  // Links between systems become remote channels on their own
+  Ipv4AddressHelper address ("10.0.0.0", "255.255.255.252");
+  for (uint32_t r = 0; r < nRegions; r++) {
+    address.Assign (coreLink.Install (m_core, m_routers.Get (r)));
+    address.NewNetwork ();
+    Ipv4InterfaceContainer interfaces = address.Assign (accessLink.Install (m_servers.Get (r), m_routers.Get (r)));
+    m_serverAddresses.push_back (interfaces.GetAddress (0));
+    address.NewNetwork ();
+  }
+  for (uint32_t i = 0; i < nClients; i++) {
+    NetDeviceContainer devices = accessLink.Install (m_clients.Get (i), m_routers.Get (i % nRegions));
+    m_clientDevices.Add (devices.Get (0));
+    address.Assign (devices);
+    address.NewNetwork ();
+  }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+}
+
+ApplicationContainer
+ReliableUdpRegionsHelper::InstallServers (ReliableUdpServerHelper &server)
+{
+  ApplicationContainer apps;
+  for (uint32_t r = 0; r < m_servers.GetN (); r++) {
+    if (m_servers.Get (r)->GetSystemId () == m_systemId) {
+      m_serverApps[r] = server.Install (m_servers.Get (r)).Get (0);
+      apps.Add (m_serverApps[r]);
+    }
+  }
+  return apps;
+}
+
+ApplicationContainer
+ReliableUdpRegionsHelper::InstallClients (ReliableUdpClientHelper &client, uint16_t port)
+{
+  ApplicationContainer apps;
+  uint32_t nRegions = m_servers.GetN ();
+  client.SetAttribute ("RemotePort", UintegerValue (port));
+  for (uint32_t i = 0; i < m_clients.GetN (); i++) {
+    if (IsLocalClient (i)) {
+      client.SetAttribute ("RemoteAddress", AddressValue (m_serverAddresses[(i % nRegions + 1) % nRegions]));
+      apps.Add (client.Install (m_clients.Get (i)));
+    }
+  }
+  return apps;
+}
+
+int64_t
+ReliableUdpRegionsHelper::AssignStreams (int64_t stream)
+{
+  for (uint32_t r = 0; r < m_serverApps.size (); r++) {
+    Ptr<ReliableUdpServer> server = DynamicCast<ReliableUdpServer> (m_serverApps[r]);
+    if (server != 0) {
+      server->AssignStreams (stream + r * ReliableUdpServer::STREAM_BLOCK);
+    }
+  }
+  return m_serverApps.size () * ReliableUdpServer::STREAM_BLOCK;
+}
+
+Ptr<Node>
+ReliableUdpRegionsHelper::GetClient (uint32_t i) const
+{
+  return m_clients.Get (i);
+}
+
+Ptr<NetDevice>
+ReliableUdpRegionsHelper::GetClientDevice (uint32_t i) const
+{
+  return m_clientDevices.Get (i);
+}
+
+bool
+ReliableUdpRegionsHelper::IsLocalClient (uint32_t i) const
+{
+  return m_clients.Get (i)->GetSystemId () == m_systemId;
+}
+
+uint32_t
+ReliableUdpRegionsHelper::GetNClients (void) const
+{
+  return m_clients.GetN ();
+}
+
+} // namespace ns3
@@ -0,0 +1,212 @@
+#ifndef RELIABLE_UDP_TOPOLOGY_HELPER_H
+#define RELIABLE_UDP_TOPOLOGY_HELPER_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/application-container.h"
+#include "ns3/node-container.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/point-to-point-dumbbell.h"
+#include "ns3/point-to-point-star.h"
+#include "reliable-udp-server-helper.h"
+#include "reliable-udp-client-helper.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Build a dumbbell of server/client pairs sharing a bottleneck.
+ *
+ * The left leaves hold nPairs servers followed by nCrossFlows TCP senders,
+ * the right leaves the matching clients and TCP sinks, so server i streams
+ * to client i and every flow crosses the bottleneck between the two
+ * routers. The constructor builds the links, installs the internet stack,
+ * assigns addresses from 10.1/16 (left), 10.2/16 (right) and 10.3/16
+ * (bottleneck) and populates global routing.
+ */
+class ReliableUdpDumbbellHelper
+{
+public:
+  /**
+   * \param nPairs number of server/client pairs
+   * \param nCrossFlows number of TCP flows competing at the bottleneck
+   * \param accessLink link of every leaf to its router
+   * \param bottleneckLink link between the routers
+   */
+  ReliableUdpDumbbellHelper (uint32_t nPairs, uint32_t nCrossFlows,
+                             PointToPointHelper accessLink, PointToPointHelper bottleneckLink);
+
+  /**
+   * \brief Install a server on each of the nPairs server leaves.
+   * \param server helper of the servers
+   * \return the servers, in pair order
+   */
+  ApplicationContainer InstallServers (ReliableUdpServerHelper &server);
+
+  /**
+   * \brief Install a client on each of the nPairs client leaves, pointed at the server of its pair.
+   * The RemoteAddress and RemotePort attributes of the helper are overwritten.
+   * \param client helper of the clients
+   * \param port port of the servers
+   * \return the clients, in pair order
+   */
+  ApplicationContainer InstallClients (ReliableUdpClientHelper &client, uint16_t port);
+
+  /**
+   * \brief Install a greedy TCP flow on each cross traffic leaf pair.
+   * \param port port of the sinks
+   * \param start time the senders start
+   * \param stop time the senders stop
+   * \return the PacketSinks, whose TotalRx is the goodput of each flow
+   */
+  ApplicationContainer InstallCrossTraffic (uint16_t port, Time start, Time stop);
+
+  /**
+   * \return the underlying ns-3 dumbbell, e.g. to reach the routers
+   */
+  const PointToPointDumbbellHelper &GetDumbbell (void) const;
+
+private:
+  PointToPointDumbbellHelper m_dumbbell; //!< Nodes, links and addresses
+  uint32_t m_nPairs;      //!< Number of server/client pairs
+  uint32_t m_nCrossFlows; //!< Number of TCP flows
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Build a star with one server at the hub fanning out to a client on every spoke.
+ *
+ * A single ReliableUdpServer serves all clients, one session each, so the
+ * star stresses the session table and the server rather than a shared
+ * link. Spoke i is the subnet 10.1.i/24 and global routing is populated.
+ */
+class ReliableUdpStarHelper
+{
+public:
+  /**
+   * \param nClients number of spokes, one client each
+   * \param spokeLink link of every spoke to the hub
+   */
+  ReliableUdpStarHelper (uint32_t nClients, PointToPointHelper spokeLink);
+
+  /**
+   * \brief Install the server on the hub.
+   * \param server helper of the server
+   * \return the server
+   */
+  ApplicationContainer InstallServer (ReliableUdpServerHelper &server);
+
+  /**
+   * \brief Install a client on every spoke, pointed at the hub address of its spoke.
+   * The RemoteAddress and RemotePort attributes of the helper are overwritten.
+   * \param client helper of the clients
+   * \param port port of the server
+   * \return the clients, in spoke order
+   */
+  ApplicationContainer InstallClients (ReliableUdpClientHelper &client, uint16_t port);
+
+  /**
+   * \return the underlying ns-3 star
+   */
+  const PointToPointStarHelper &GetStar (void) const;
+
+private:
+  PointToPointStarHelper m_star; //!< Nodes, links and addresses
+};
+
+/**
+ * \ingroup reliableudpserver
+ * \brief Build regions of a server and clients around a core router, to be split across processes.
+ *
+ * Region r has a router linked to the core by coreLink, and a server and 
+ * the clients i with i % nRegions == r linked to the router by accessLink. 
+ * Client i streams from the server of the next region, so every flow crosses 
+ * two core links. Every link is a /30 of 10/8 and global routing is populated.
+ *
+ * For a distributed simulation the nodes of region r belong to the process 
+ * r % nSystems and the core to process 0, so the core links are the only 
+ * links between processes and their delay is the lookahead. Every process 
+ * builds the whole topology, as ns-3 requires, but installs applications 
+ * only on its own nodes. With one system the topology runs sequentially 
+ * and the same.
+ */
+class ReliableUdpRegionsHelper
+{
+public:
+  /**
+   * \param nRegions number of regions, one server each
+   * \param nClients number of clients over all regions
+   * \param accessLink link of every server and client to the router of its region
+   * \param coreLink link of every regional router to the core
+   * \param nSystems number of processes the regions are spread over
+   * \param systemId the process building the topology
+   */
+  ReliableUdpRegionsHelper (uint32_t nRegions, uint32_t nClients,
+                            PointToPointHelper accessLink, PointToPointHelper coreLink,
+                            uint32_t nSystems = 1, uint32_t systemId = 0);
+
+  /**
+   * \brief Install a server in each region of this process.
+   * \param server helper of the servers
+   * \return the servers, in region order
+   */
+  ApplicationContainer InstallServers (ReliableUdpServerHelper &server);
+
+  /**
+   * \brief Install each client of this process, pointed at the server of the next region.
+   * The RemoteAddress and RemotePort attributes of the helper are overwritten.
+   * \param client helper of the clients
+   * \param port port of the servers
+   * \return the clients, in client order
+   */
+  ApplicationContainer InstallClients (ReliableUdpClientHelper &client, uint16_t port);
+
+  /**
+   * \brief Assign fixed random variable streams to the servers installed by InstallServers().
+   * The server of region r gets the block starting at 
+   * stream + r * ReliableUdpServer::STREAM_BLOCK whichever process it is in, 
+   * so a distributed run draws the same numbers as a sequential one.
+   * \param stream first stream index to use
+   * \return the number of stream indices reserved for all regions
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \param i index of a client
+   * \return its node
+   */
+  Ptr<Node> GetClient (uint32_t i) const;
+
+  /**
+   * \param i index of a client
+   * \return the device of its access link; device 0 of the node is its loopback
+   */
+  Ptr<NetDevice> GetClientDevice (uint32_t i) const;
+
+  /**
+   * \param i index of a client
+   * \return whether its node belongs to this process
+   */
+  bool IsLocalClient (uint32_t i) const;
+
+  /**
+   * \return the number of clients over all regions
+   */
+  uint32_t GetNClients (void) const;
+
+private:
+  Ptr<Node> m_core;         //!< Core router
+  NodeContainer m_routers;  //!< Router of each region
+  NodeContainer m_servers;  //!< Server node of each region
+  NodeContainer m_clients;  //!< Client nodes, region i % nRegions each
+  NetDeviceContainer m_clientDevices; //!< Access link device of each client
+  std::vector<Ipv4Address> m_serverAddresses; //!< Address of each server node
+  std::vector<Ptr<Application> > m_serverApps; //!< Server of each region; 0 in other processes
+  uint32_t m_systemId;      //!< The process building the topology
+};
+
+} // namespace ns3
+
+#endif /* RELIABLE_UDP_TOPOLOGY_HELPER_H */
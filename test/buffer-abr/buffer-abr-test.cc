@@ -0,0 +1,84 @@
+/*
+ * Check of ReliableUdpBufferAbr with its default attributes.
+ *
+ * A server streams live to one client over a clean point-to-point link
+ * with a three-rung BitrateLadder and the buffer-based policy. The buffer
+ * of a live client stays near its target depth, so the policy must leave
+ * the lowest rung. It exits with 1 if no stream ever switched above it.
+ */
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "../reliable-udp-server-helper.h"
+#include "../reliable-udp-client-helper.h"
+#include "../reliable-udp-abr.h"
+
+using namespace ns3;
+
+namespace {
+
+const DataRate g_lowest ("500kbps");
+DataRate g_highest = g_lowest;
+
+void
+BitrateSwitch (uint16_t streamId, DataRate from, DataRate to)
+{
+  if (to > g_highest) {
+    g_highest = to;
+  }
+}
+
+void
+NewSession (Ptr<ReliableUdpSession> session)
+{
+  session->TraceConnectWithoutContext ("BitrateSwitch", MakeCallback (&BitrateSwitch));
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  double duration = 20;
+  CommandLine cmd;
+  cmd.AddValue ("duration", "Simulated seconds of streaming", duration);
+  cmd.Parse (argc, argv);
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("5ms"));
+  NetDeviceContainer devices = p2p.Install (nodes);
+  InternetStackHelper stack;
+  stack.Install (nodes);
+  Ipv4AddressHelper addr;
+  addr.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = addr.Assign (devices);
+
+  ReliableUdpServerHelper server (9);
+  server.SetAttribute ("BitrateLadder", StringValue ("500kbps,1Mbps,2Mbps"));
+  server.SetAttribute ("AbrPolicy", TypeIdValue (ReliableUdpBufferAbr::GetTypeId ()));
+  ApplicationContainer serverApps = server.Install (nodes.Get (1));
+  ReliableUdpClientHelper client (interfaces.GetAddress (1), 9);
+  ApplicationContainer clientApps = client.Install (nodes.Get (0));
+  serverApps.Get (0)->TraceConnectWithoutContext ("NewSession", MakeCallback (&NewSession));
+  serverApps.Start (Seconds (0));
+  clientApps.Start (Seconds (0));
+  clientApps.Stop (Seconds (duration));
+  serverApps.Stop (Seconds (duration));
+
+  Simulator::Stop (Seconds (duration + 1));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::cout << "highest bitrate " << g_highest << std::endl;
+  if (g_highest == g_lowest) {
+    std::cout << "FAIL: the buffer-based policy never left the lowest rung" << std::endl;
+    return 1;
+  }
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
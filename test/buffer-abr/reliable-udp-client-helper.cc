@@ -0,0 +1,2 @@
+// Builds the source under test into the test program
+#include "../reliable-udp-client-helper.cc"
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Decode an event trace of ReliableUdpEventRecorder into CSV.
+
+Usage: decode-events.py TRACE [-o OUT.csv]
+
+The trace is an 8-byte header ("RUEV", uint16 version, uint16 record
+size) followed by little-endian records:
+time (int64 ns), type (uint8), flags (uint8), stream (uint16),
+seq (uint32), size (uint32).
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+EVENT_TYPES = {
+    1: "TX_DATA",
+    2: "TX_PARITY",
+    3: "TX_PROBE",
+    4: "RX_ACK",
+    5: "LOSS",
+    6: "ABANDON",
+    7: "TX_DROP",
+    8: "RX_DATA",
+    9: "RX_PARITY",
+    10: "FEC_RECOVERED",
+    11: "RX_DROP",
+    12: "TX_ACK",
+    13: "FRAME_PLAYED",
+    14: "STALL",
+    15: "TX_KEEPALIVE",
+    16: "TX_NACK",
+    17: "RX_NACK",
+}
+
+EVENT_FLAGS = [
+    (0x01, "RETRANSMIT"),
+    (0x02, "DUPLICATE"),
+    (0x04, "OUT_OF_ORDER"),
+    (0x08, "LATE"),
+    (0x10, "SKIPPED"),
+]
+
+HEADER = struct.Struct("<4sHH")
+RECORD = struct.Struct("<qBBHII")
+FORMAT_VERSION = 1
+BLOCK_RECORDS = 65536
+
+
+def flag_names(flags):
+    return "|".join(name for bit, name in EVENT_FLAGS if flags & bit)
+
+
+def decode(trace, out):
+    magic, version, record_size = HEADER.unpack(trace.read(HEADER.size))
+    if magic != b"RUEV":
+        sys.exit("not an event trace")
+    if version != FORMAT_VERSION or record_size != RECORD.size:
+        sys.exit("unsupported trace version %d with %d-byte records" % (version, record_size))
+
+    writer = csv.writer(out, lineterminator="\n")
+    writer.writerow(["time", "event", "flags", "stream", "seq", "size"])
+    records = 0
+    while True:
+        block = trace.read(BLOCK_RECORDS * RECORD.size)
+        if not block:
+            break
+        # A trace cut short by a crash may end in a partial record
+        usable = len(block) - len(block) % RECORD.size
+        for time, kind, flags, stream, seq, size in RECORD.iter_unpack(block[:usable]):
+            writer.writerow(["%.9f" % (time * 1e-9), EVENT_TYPES.get(kind, str(kind)),
+                             flag_names(flags), stream, seq, size])
+        records += usable // RECORD.size
+        if usable != len(block):
+            print("warning: trailing partial record ignored", file=sys.stderr)
+            break
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help="binary event trace")
+    parser.add_argument("-o", "--output", help="CSV file; standard output if omitted")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as trace:
+        if args.output:
+            with open(args.output, "w") as out:
+                records = decode(trace, out)
+            print("%d events" % records, file=sys.stderr)
+        else:
+            decode(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
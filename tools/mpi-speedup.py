@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Run the regions topology sequentially and distributed over MPI, and report the speedup.
+
+The same scenario is run once as a single sequential process and then with
+--distributed under mpirun for every process count of --np. Each run writes
+its result with --result; the distributed results are compared with the
+sequential one and the wall-clock speedup against the process count is
+printed and written to <out>/speedup.json.
+
+Run it from the ns-3 directory of the container, where ./waf is, with ns-3
+configured with --enable-mpi, e.g.
+
+    mpi-speedup.py --np 2,4,8 --extra "--nRegions=8 --nClients=256 --stopTime=29"
+
+The program is built once, then started with ./waf --run-no-build.
+"""
+
+import argparse
+import json
+import os
+import shlex
+import subprocess
+import sys
+
+# Measured values that must not depend on how the run was split
+COMPARED = ["goodput", "jainIndex", "delayP50", "delayP95", "delayP99", "retransmissionRatio", "flowGoodputs"]
+
+
+def run(args, np):
+    name = "sequential" if np == 0 else "np-%d" % np
+    result = os.path.abspath(os.path.join(args.out, name + ".json"))
+    options = ["--topology=regions", "--pcap=0", "--result=%s" % result] + shlex.split(args.extra)
+    command = [args.waf, "--run-no-build", " ".join([args.program] + options)]
+    if np > 0:
+        command[-1] += " --distributed=1"
+        command.insert(1, "--command-template=%s -np %d %%s" % (args.mpirun, np))
+    with open(os.path.join(args.out, name + ".log"), "w") as out:
+        code = subprocess.call(command, stdout=out, stderr=subprocess.STDOUT)
+    if code != 0 or not os.path.exists(result):
+        sys.exit("%s failed (exit %d); see %s.log" % (name, code, os.path.join(args.out, name)))
+    with open(result) as f:
+        return json.load(f)
+
+
+def differences(expected, measured, tolerance):
+    diffs = []
+    for key in COMPARED:
+        a = expected[key] if isinstance(expected[key], list) else [expected[key]]
+        b = measured[key] if isinstance(measured[key], list) else [measured[key]]
+        if len(a) != len(b) or any(abs(x - y) > tolerance * max(abs(x), abs(y)) for x, y in zip(a, b)):
+            diffs.append(key)
+    return diffs
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--np", default="2,4", help="comma-separated process counts of the distributed runs")
+    parser.add_argument("--out", default="mpi-speedup", help="directory of the results and logs")
+    parser.add_argument("--program", default="master", help="scratch program to run")
+    parser.add_argument("--waf", default="./waf", help="waf of the ns-3 tree")
+    parser.add_argument("--mpirun", default="mpirun", help="MPI launcher")
+    parser.add_argument("--tolerance", type=float, default=0,
+                        help="relative difference from the sequential run accepted as a match")
+    parser.add_argument("--extra", default="", help="options passed to every run as they are")
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    if subprocess.call([args.waf, "build"]) != 0:
+        sys.exit("build failed")
+
+    sequential = run(args, 0)
+    rows = [{"ranks": 1, "wallClock": sequential["wallClock"], "speedup": 1.0, "matches": True}]
+    print("%6s %10s %8s  %s" % ("ranks", "wall s", "speedup", "result"))
+    print("%6d %10.3f %8.2f  sequential" % (1, sequential["wallClock"], 1.0))
+    mismatched = 0
+    for np in [int(n) for n in args.np.split(",")]:
+        measured = run(args, np)
+        diffs = differences(sequential, measured, args.tolerance)
+        mismatched += bool(diffs)
+        speedup = sequential["wallClock"] / measured["wallClock"]
+        rows.append({"ranks": np, "wallClock": measured["wallClock"], "speedup": speedup,
+                     "matches": not diffs, "differs": diffs})
+        print("%6d %10.3f %8.2f  %s" % (np, measured["wallClock"], speedup,
+                                         "matches" if not diffs else "differs in " + ", ".join(diffs)))
+
+    with open(os.path.join(args.out, "speedup.json"), "w") as f:
+        json.dump(rows, f, indent=2)
+    sys.exit(1 if mismatched else 0)
+
+
+if __name__ == "__main__":
+    main()
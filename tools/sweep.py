@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Run master over a parameter grid on all local cores and gather the results.
+
+Every point of the grid is run --runs times with RngRun 1, 2, ... as an
+independent simulation process. Each process writes its result with
+--result, and the results are gathered into <out>/results.json and
+<out>/results.csv together with the parameters of their point.
+
+Run it from the ns-3 directory of the container, where ./waf is, e.g.
+
+    sweep.py --param dataRate=2Mbps,5Mbps --param errorRate=0,0.01 --runs 3
+
+The program is built once, then started with ./waf --run-no-build.
+"""
+
+import argparse
+import csv
+import itertools
+import json
+import os
+import shlex
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+
+def parse_grid(params):
+    grid = []
+    for param in params:
+        name, sep, values = param.partition("=")
+        if not sep or not values:
+            sys.exit("--param takes name=value1,value2,...: %s" % param)
+        grid.append((name, values.split(",")))
+    return grid
+
+
+def run_point(args, index, point, run):
+    result = os.path.abspath(os.path.join(args.out, "run-%04d.json" % index))
+    options = ["--%s=%s" % (name, value) for name, value in point]
+    options += ["--RngRun=%d" % run, "--pcap=0", "--result=%s" % result]
+    options += shlex.split(args.extra)
+    command = [args.waf, "--run-no-build", " ".join([args.program] + options)]
+    log = os.path.join(args.out, "run-%04d.log" % index)
+    start = time.time()
+    with open(log, "w") as out:
+        code = subprocess.call(command, stdout=out, stderr=subprocess.STDOUT)
+    row = dict(point)
+    row["run"] = run
+    row["exitCode"] = code
+    row["processTime"] = time.time() - start
+    if code == 0 and os.path.exists(result):
+        with open(result) as f:
+            measured = json.load(f)
+        # Values of the grid stay as they were given
+        for key, value in measured.items():
+            row.setdefault(key, value)
+    return row
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--param", action="append", default=[],
+                        help="name=value1,value2,... of a master option; repeat for more")
+    parser.add_argument("--runs", type=int, default=1, help="runs per point, with RngRun 1..runs")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="simulations run at once")
+    parser.add_argument("--out", default="sweep", help="directory of the results and logs")
+    parser.add_argument("--program", default="master", help="scratch program to run")
+    parser.add_argument("--waf", default="./waf", help="waf of the ns-3 tree")
+    parser.add_argument("--extra", default="", help="options passed to every run as they are")
+    args = parser.parse_args()
+
+    grid = parse_grid(args.param)
+    names = [name for name, _ in grid]
+    points = [list(zip(names, values)) for values in itertools.product(*[v for _, v in grid])]
+    jobs = [(point, run) for point in points for run in range(1, args.runs + 1)]
+
+    os.makedirs(args.out, exist_ok=True)
+    if subprocess.call([args.waf, "build"]) != 0:
+        sys.exit("build failed")
+
+    print("%d runs of %d points on %d cores" % (len(jobs), len(points), args.jobs), file=sys.stderr)
+    rows = []
+    start = time.time()
+    # Threads only wait for the simulation processes, which do the work
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = [pool.submit(run_point, args, i, point, run) for i, (point, run) in enumerate(jobs)]
+        for done, future in enumerate(as_completed(futures), 1):
+            row = future.result()
+            rows.append(row)
+            status = "ok" if row["exitCode"] == 0 else "failed (exit %d)" % row["exitCode"]
+            print("[%d/%d] %s run %d %s" % (done, len(jobs),
+                                            " ".join("%s=%s" % p for p in row.items() if p[0] in names),
+                                            row["run"], status), file=sys.stderr)
+    rows.sort(key=lambda row: ([str(row[name]) for name in names], row["run"]))
+
+    with open(os.path.join(args.out, "results.json"), "w") as f:
+        json.dump(rows, f, indent=2)
+    columns = names + ["run"]
+    for row in rows:
+        columns += [key for key in row if key not in columns]
+    with open(os.path.join(args.out, "results.csv"), "w") as f:
+        writer = csv.DictWriter(f, fieldnames=columns, lineterminator="\n")
+        writer.writeheader()
+        writer.writerows(rows)
+
+    failed = sum(1 for row in rows if row["exitCode"] != 0)
+    print("%d runs in %.1fs, %d failed; results in %s" % (len(rows), time.time() - start, failed, args.out),
+          file=sys.stderr)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()